@@ -0,0 +1,44 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "avsimg.h"
+
+namespace {
+	struct AvsPlanes {
+		YuvImg::PlaneData data[3];
+		AvsPlanes(const PVideoFrame &src, const VideoInfo &vi);
+	};
+}
+
+AvsPlanes::AvsPlanes(const PVideoFrame &src, const VideoInfo &vi)
+{
+	const int yuv_planes[3]={PLANAR_Y, PLANAR_U, PLANAR_V};
+
+	for (int p=0; p<3; p++) {
+		if (!src->IsWritable())
+			data[p].ptr=(unsigned char*)src->GetReadPtr(yuv_planes[p]);	
+		else
+			data[p].ptr=src->GetWritePtr(yuv_planes[p]);
+		data[p].pitch=src->GetPitch(yuv_planes[p]);
+		data[p].width=src->GetRowSize(yuv_planes[p]);
+		data[p].height=src->GetHeight(yuv_planes[p]);
+		data[p].width_sub=vi.GetPlaneWidthSubsampling(yuv_planes[p]);
+		data[p].height_sub=vi.GetPlaneHeightSubsampling(yuv_planes[p]);
+		data[p].bit_depth=8;	//AviSynth 2.6 has only 8-bit formats
+	}
+}
+
+//Temporary AvsPlanes lives until base constructor copies plane descriptions
+AvsImg::AvsImg(const PVideoFrame &src, const VideoInfo &vi):
+	SsocrImg(AvsPlanes(src, vi).data, vi.width, vi.height, !src->IsWritable())
+{}
\ No newline at end of file
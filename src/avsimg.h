@@ -0,0 +1,26 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AVSIMG_H
+#define AVSIMG_H
+
+#include "ssocr_imgproc.h"
+#include "avisynth.h"
+
+//Thin AviSynth adapter: plane view of PVideoFrame, frame should outlive the image
+class AvsImg: public SsocrImg {
+public:
+	AvsImg(const PVideoFrame &src, const VideoInfo &vi);
+};
+
+#endif //AVSIMG_H
\ No newline at end of file
@@ -0,0 +1,193 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "avsprefetch.h"
+
+AvsPrefetch::AvsPrefetch(PClip child, IScriptEnvironment *env):
+	child(child), env(env), trace(NULL), wake(CreateEvent(NULL, FALSE, FALSE, NULL)), released(CreateEvent(NULL, TRUE, FALSE, NULL)), thread(NULL), slots(), recognizing(false), stop(false)
+{
+	InitializeCriticalSection(&lock);
+	InitializeCriticalSection(&upstream);
+	thread=CreateThread(NULL, 0, Proc, this, 0, NULL);
+}
+
+AvsPrefetch::~AvsPrefetch()
+{
+	EnterCriticalSection(&lock);
+	stop=true;
+	LeaveCriticalSection(&lock);
+	SetEvent(wake);
+	SetEvent(released);
+	if (thread) {
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+	}
+	slots.clear();
+	CloseHandle(wake);
+	CloseHandle(released);
+	DeleteCriticalSection(&upstream);
+	DeleteCriticalSection(&lock);
+}
+
+void AvsPrefetch::SetTrace(SsocrTrace *trace)
+{
+	this->trace=trace;
+}
+
+DWORD WINAPI AvsPrefetch::Proc(LPVOID arg)
+{
+	((AvsPrefetch*)arg)->Run();
+	return 0;
+}
+
+void AvsPrefetch::Run()
+{
+	for (;;) {
+		WaitForSingleObject(wake, INFINITE);
+		for (;;) {
+			WaitForSingleObject(released, INFINITE);
+			EnterCriticalSection(&upstream);
+			EnterCriticalSection(&lock);
+			std::deque<Slot>::iterator it=slots.begin();
+			while (it!=slots.end()&&it->fetched)
+				it++;
+			if (stop||it==slots.end()) {
+				bool done=stop;
+				LeaveCriticalSection(&lock);
+				LeaveCriticalSection(&upstream);
+				if (done)
+					return;
+				break;
+			}
+			//Filter has taken the lock back since the event was checked, so wait for the next recognition
+			if (!recognizing) {
+				LeaveCriticalSection(&lock);
+				LeaveCriticalSection(&upstream);
+				continue;
+			}
+			int n=it->n;
+			LeaveCriticalSection(&lock);
+
+			//Frame is stored and released under upstream lock, so filter never sees it being fetched
+			{
+				PVideoFrame frame;
+				bool failed=false;
+				SsocrTicks start=SsocrTrace::Start(trace);
+				try {
+					frame=child->GetFrame(n, env);
+				} catch (...) {
+					failed=true;
+				}
+				SsocrTrace::Stop(trace, "prefetch GetFrame", start);
+
+				//Failed frame is dropped to be requested synchronously
+				EnterCriticalSection(&lock);
+				for (it=slots.begin(); it!=slots.end(); it++)
+					if (it->n==n) {
+						if (failed) {
+							slots.erase(it);
+						} else {
+							it->frame=frame;
+							it->fetched=true;
+						}
+						break;
+					}
+				LeaveCriticalSection(&lock);
+			}
+			LeaveCriticalSection(&upstream);
+		}
+	}
+}
+
+void AvsPrefetch::Schedule(const std::vector<int> &frames)
+{
+	std::deque<Slot> scheduled;
+
+	EnterCriticalSection(&lock);
+	for (std::vector<int>::const_iterator n=frames.begin(); n!=frames.end(); n++) {
+		Slot slot;
+		slot.n=*n;
+		slot.fetched=false;
+		for (std::deque<Slot>::iterator it=slots.begin(); it!=slots.end(); it++)
+			if (it->n==*n) {
+				slot=*it;
+				break;
+			}
+		scheduled.push_back(slot);
+	}
+	slots.swap(scheduled);
+	LeaveCriticalSection(&lock);
+	SetEvent(wake);
+	//Frames that are no longer scheduled are released here, outside of the lock but still under upstream lock
+}
+
+PVideoFrame AvsPrefetch::GetFrame(int n)
+{
+	EnterCriticalSection(&lock);
+	std::deque<Slot>::iterator it=slots.begin();
+	while (it!=slots.end()&&it->n!=n)
+		it++;
+	if (it!=slots.end()&&it->fetched) {
+		PVideoFrame frame=it->frame;
+		slots.erase(it);
+		LeaveCriticalSection(&lock);
+		return frame;
+	}
+	//Frame is requested right now, so background thread shouldn't fetch it again
+	if (it!=slots.end())
+		slots.erase(it);
+	LeaveCriticalSection(&lock);
+
+	return child->GetFrame(n, env);
+}
+
+void AvsPrefetch::EnterUpstream()
+{
+	EnterCriticalSection(&upstream);
+	recognizing=false;
+	ResetEvent(released);
+}
+
+void AvsPrefetch::LeaveUpstream(bool fetch)
+{
+	if (fetch) {
+		recognizing=true;
+		SetEvent(released);
+	}
+	LeaveCriticalSection(&upstream);
+}
+
+AvsUpstreamLock::AvsUpstreamLock(AvsPrefetch *prefetch):
+	prefetch(prefetch), held(false)
+{
+	Acquire();
+}
+
+AvsUpstreamLock::~AvsUpstreamLock()
+{
+	Release(false);
+}
+
+void AvsUpstreamLock::Acquire()
+{
+	if (prefetch&&!held)
+		prefetch->EnterUpstream();
+	held=true;
+}
+
+void AvsUpstreamLock::Release(bool fetch)
+{
+	if (prefetch&&held)
+		prefetch->LeaveUpstream(fetch);
+	held=false;
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AVSPREFETCH_H
+#define AVSPREFETCH_H
+
+#include <deque>
+#include <vector>
+#include <windows.h>
+#include "ssocr_trace.h"
+#include "avisynth.h"
+
+//Requests upcoming frames from child clip in background thread, so upstream filters decode them while current frame is recognized
+//AviSynth 2.6 isn't thread-safe: filter holds upstream lock for the whole GetFrame except recognition
+//Background thread enters upstream filters only while filter has released the lock, so decoding overlaps only with recognition
+//Frame that wasn't prefetched (or failed to decode in background) is requested synchronously, so errors are thrown in filter's thread
+class AvsPrefetch {
+private:
+	struct Slot {
+		int n;
+		PVideoFrame frame;
+		bool fetched;
+	};
+
+	PClip child;
+	IScriptEnvironment *env;
+	SsocrTrace *trace;			//NULL if tracing is disabled
+	CRITICAL_SECTION lock;		//Protects slots and stop
+	CRITICAL_SECTION upstream;	//Serializes calls to upstream filters and environment
+	HANDLE wake;				//Set when frames are scheduled or thread should stop
+	HANDLE released;			//Manual-reset, set while filter recognizes with upstream lock released
+	HANDLE thread;
+	std::deque<Slot> slots;		//Scheduled frames in order of expected requests
+	bool recognizing;			//Same as released, but changed and checked under upstream lock
+	bool stop;
+
+	static DWORD WINAPI Proc(LPVOID arg);
+	void Run();
+public:
+	AvsPrefetch(PClip child, IScriptEnvironment *env);
+	~AvsPrefetch();
+	void SetTrace(SsocrTrace *trace);
+	//Replaces scheduled frames, already fetched ones are kept if they are still scheduled
+	void Schedule(const std::vector<int> &frames);
+	//Returns prefetched frame or requests it synchronously, called under upstream lock
+	PVideoFrame GetFrame(int n);
+	//Filter's own calls to environment (e.g. MakeWritable) should be made under upstream lock
+	//If fetch is true, background thread fetches frames until the lock is entered again
+	void EnterUpstream();
+	void LeaveUpstream(bool fetch);
+};
+
+//Holds upstream lock for the scope, so exception thrown by environment doesn't leave it locked
+class AvsUpstreamLock {
+private:
+	AvsPrefetch *prefetch;		//NULL if prefetch is disabled
+	bool held;
+public:
+	AvsUpstreamLock(AvsPrefetch *prefetch);
+	~AvsUpstreamLock();
+	void Acquire();
+	void Release(bool fetch);
+};
+
+#endif //AVSPREFETCH_H
\ No newline at end of file
@@ -18,18 +18,44 @@
 #include <sstream>
 #include <cctype>
 #include <windows.h>
-#include "yuvimg.h"
-#include "ssocr_imgproc.h"
+#include "avsimg.h"
 #include "ssocr_defines.h"
 #include "ocrf.h"
 
 const AVS_Linkage *AVS_linkage=NULL;
 
+static const unsigned char yellow[3]={210, 16, 146};
+
+//Returns -1 if file can't be opened
+static long long GetLogSize(const char* path)
+{
+	HANDLE file=CreateFile(path, GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file==INVALID_HANDLE_VALUE)
+		return -1;
+	DWORD high=0;
+	DWORD low=GetFileSize(file, &high);
+	CloseHandle(file);
+	if (low==INVALID_FILE_SIZE&&GetLastError()!=NO_ERROR)
+		return -1;
+	return ((long long)high<<32)|low;
+}
+
+static bool TruncateLog(const char* path, long long size)
+{
+	HANDLE file=CreateFile(path, GENERIC_WRITE, FILE_SHARE_READ|FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file==INVALID_HANDLE_VALUE)
+		return false;
+	LONG high=(LONG)(size>>32);
+	bool truncated=(SetFilePointer(file, (LONG)size, &high, FILE_BEGIN)!=INVALID_SET_FILE_POINTER||GetLastError()==NO_ERROR)&&SetEndOfFile(file);
+	CloseHandle(file);
+	return truncated;
+}
+
 //Filter object is created when AVS file is first read by AviSynth
 //Filters are created in order of appearance in AVS file
-OCRFilter::OCRFilter(PClip child, const char* log_file, bool log_append, int interval, const char* time_format, bool debug, bool localized_output, bool inverted, const char* threshold, IScriptEnvironment *env):
+OCRFilter::OCRFilter(PClip child, const char* log_file, bool log_append, int interval, const char* time_format, bool debug, bool localized_output, bool inverted, const char* threshold, const char* trace_file, const char* metrics_file, bool sparse, bool memoize, bool log_sorted, const char* cleanup, int cache_size, bool track, int threads, int prefetch, const char* cache_file, const char* checkpoint, int glyph_cache, const char* classifier, double budget, int field, IScriptEnvironment *env):
 	GenericVideoFilter(child),
-	fduration(((double)vi.fps_denominator/vi.fps_numerator*1000)), timer(interval*1000), last_frame(-1), time_format(SEC), debug(debug), log_file(), csv_sep(), dec_sep(), neg_sign(), ssocr()
+	timer(vi.fps_numerator, vi.fps_denominator, interval), last_frame(-1), time_format(SEC), debug(debug), sparse(sparse), log_sorted(log_sorted), log_file(), csv_sep(), dec_sep(), neg_sign(), ssocr(), trace(NULL), trace_file(trace_file), metrics(NULL), memo(NULL), shared(false), cache_key(), cache_config(), binarized(), disk_cache(NULL), disk_config(0), tracker(NULL), strips(NULL), prefetch(NULL), prefetch_depth(prefetch), checkpoint(NULL), checkpoint_config(), log_path(log_file), resume_frame(-1), skipped(), deadline(NULL), last_level(FULL_QUALITY), field(field)
 {
 	if (interval<0)
 		env->ThrowError("SegmentDisplayOCR: interval can't be negative number!");
@@ -52,15 +78,59 @@ OCRFilter::OCRFilter(PClip child, const char* log_file, bool log_append, int int
 		env->ThrowError("SegmentDisplayOCR: non-interlaced video only!");
 	}
 
+	if (field<-1||field>1)
+		env->ThrowError("SegmentDisplayOCR: field should be -1, 0 or 1!");
+
 	if (!vi.IsPlanar()||!vi.IsYUV()||vi.IsY8()) {
 		env->ThrowError("SegmentDisplayOCR: YV12, YV16, YV24 and YV411 video only!");
 	}
 
+	if (log_sorted&&this->time_format==RTM)
+		env->ThrowError("SegmentDisplayOCR: log_sorted can't be used with realtime time_format!");
+
+	if (budget<0.0)
+		env->ThrowError("SegmentDisplayOCR: budget can't be negative number!");
+	//Degradation level is logged with every record, sorted log is written after the fact
+	if (budget>0.0&&log_sorted)
+		env->ThrowError("SegmentDisplayOCR: budget can't be used with log_sorted!");
+
+	//Results are memoized for input clip frames
+	if (memoize||log_sorted)
+		memo=new SsocrMemo(vi.num_frames);
+
+	//In sparse mode output frame n is n-th sample of input clip, so upstream filters decode only recognized frames
+	//Output frame rate is one frame per interval, so output clip has the same duration as input one
+	if (sparse&&timer.GetSampleCount(vi.num_frames)!=vi.num_frames) {
+		vi.num_frames=timer.GetSampleCount(vi.num_frames);
+		vi.SetFPS(1, interval);
+	}
+
+	SsocrCheckpoint::State resume_state;
+	bool resume=false;
+	if (strlen(checkpoint)>0) {
+		//Sorted log is written only when filter is destroyed, so there is no progress to save
+		if (log_sorted)
+			env->ThrowError("SegmentDisplayOCR: checkpoint can't be used with log_sorted!");
+		if (!strlen(log_file))
+			env->ThrowError("SegmentDisplayOCR: checkpoint requires log_file!");
+		std::ostringstream config;
+		config<<log_file<<':'<<interval<<':'<<time_format<<':'<<sparse<<':'<<localized_output<<':'<<inverted<<':'<<threshold<<':'<<cleanup<<':'<<track<<':'<<glyph_cache<<':'<<classifier<<':'<<budget<<':'<<field;
+		checkpoint_config=config.str();
+		this->checkpoint=new SsocrCheckpoint(checkpoint);
+		//Checkpoint of another run or of the log that was since overwritten is ignored
+		resume=this->checkpoint->Load(resume_state)&&resume_state.config==checkpoint_config&&GetLogSize(log_file)>=resume_state.log_offset;
+	}
+
 	if (strlen(log_file)>0) {
 		//By default ofstream opens files with RW sharing enabled (_SH_DENYNO)
 		//This allows simultaneous write to single log for several filter instances
 		//Append mode (std::ios::app) is required for simultaneous write but it's incompatible with truncate (std::ios::trunc)
-		if (!log_append)
+		//Resumed log loses lines written after the checkpoint, they will be written again
+		if (resume) {
+			if (!TruncateLog(log_file, resume_state.log_offset))
+				env->ThrowError("SegmentDisplayOCR: error while writing file \"%s\"!", log_file);
+			last_frame=resume_frame=resume_state.frame;
+		} else if (!log_append)
 			CloseHandle(CreateFile(log_file, GENERIC_WRITE, FILE_SHARE_READ|FILE_SHARE_WRITE, NULL, TRUNCATE_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL));
 		this->log_file.open(log_file, std::ios::app);
 		if (!this->log_file.is_open())
@@ -69,11 +139,63 @@ OCRFilter::OCRFilter(PClip child, const char* log_file, bool log_append, int int
 
 	double thresh;
 	SsocrThreshold thresh_flags;
-	if (!ParseThreshold(threshold, thresh, thresh_flags))
+	if (!Ssocr::ParseThreshold(threshold, thresh, thresh_flags))
 		env->ThrowError("SegmentDisplayOCR: unrecognized threshold string \"%s\"!", threshold);
 	if (thresh<0.0||thresh>100.0)
 		env->ThrowError("SegmentDisplayOCR: threshold should be between 0 and 100!");
 	ssocr=new Ssocr(!inverted, thresh, thresh_flags);
+	if (!ssocr->SetCleanup(cleanup))
+		env->ThrowError("SegmentDisplayOCR: unrecognized cleanup string \"%s\"!", cleanup);
+
+	if (cache_size<0)
+		env->ThrowError("SegmentDisplayOCR: cache_size can't be negative number!");
+	//Temporal threshold depends on previously recognized frames of this instance so it can't be shared
+	if (cache_size>0&&thresh_flags!=TEMPORAL_THRESHOLD) {
+		shared=true;
+		SsocrBinCache::GetShared().ExtendBudget((size_t)cache_size<<20);
+		cache_key.source=(void*)child;
+		cache_key.context=env;
+		cache_key.x=0;
+		cache_key.y=0;
+		cache_key.w=vi.width;
+		cache_key.h=vi.height;
+		//Fields of the same frame have the same key rectangle
+		cache_config=GetCacheConfig(inverted, thresh, thresh_flags, cleanup)+(field<0?"":field?":odd":":even");
+		cache_key.config=cache_config;
+	}
+
+	if (glyph_cache<0)
+		env->ThrowError("SegmentDisplayOCR: glyph_cache can't be negative number!");
+	ssocr->SetGlyphCache(glyph_cache);
+
+	SsocrClassifier classifier_flags;
+	int learn_frames;
+	if (!Ssocr::ParseClassifier(classifier, classifier_flags, learn_frames))
+		env->ThrowError("SegmentDisplayOCR: unrecognized classifier string \"%s\"!", classifier);
+	ssocr->SetClassifier(classifier_flags, learn_frames);
+	//Learned templates are restored too, so resumed run doesn't learn from frames after the checkpoint
+	if (resume&&!ssocr->SetState(resume_state.recognizer))
+		env->ThrowError("SegmentDisplayOCR: malformed checkpoint file \"%s\"!", checkpoint);
+
+	if (track)
+		tracker=new SsocrTracker(!inverted);
+
+	if (budget>0.0)
+		deadline=new SsocrDeadline(budget);
+
+	if (threads<0)
+		env->ThrowError("SegmentDisplayOCR: threads can't be negative number!");
+
+	if (prefetch<0)
+		env->ThrowError("SegmentDisplayOCR: prefetch can't be negative number!");
+
+	if (strlen(trace_file)>0) {
+		//Trace is written only when filter is destroyed so check that file is writable beforehand
+		if (!std::ofstream(trace_file, std::ios::trunc).is_open())
+			env->ThrowError("SegmentDisplayOCR: error while opening file \"%s\"!", trace_file);
+		trace=new SsocrTrace();
+		ssocr->SetTrace(trace);
+	}
 
 	if (!(localized_output&&GetLocaleInfo(LOCALE_USER_DEFAULT, LOCALE_SNEGATIVESIGN, neg_sign, 5)))
 		strcpy(neg_sign, "-");
@@ -85,99 +207,311 @@ OCRFilter::OCRFilter(PClip child, const char* log_file, bool log_append, int int
 		strcpy(sdate_fmt, "yyyy'-'MM'-'dd");
 	if (!(localized_output&&GetLocaleInfo(LOCALE_USER_DEFAULT, LOCALE_STIMEFORMAT, time_fmt, 80)))
 		strcpy(time_fmt, "HH':'mm':'ss");
+
+	if (strlen(cache_file)>0) {
+		//Cached result should be the same as recognized one, so temporal threshold depending on previous frames can't be cached
+		if (thresh_flags==TEMPORAL_THRESHOLD)
+			env->ThrowError("SegmentDisplayOCR: cache_file can't be used with smoothed threshold!");
+		//Same goes for templates learned from previous frames
+		if (learn_frames>0)
+			env->ThrowError("SegmentDisplayOCR: cache_file can't be used with learning classifier!");
+		if (!(disk_cache=SsocrDiskCache::Open(cache_file)))
+			env->ThrowError("SegmentDisplayOCR: error while opening file \"%s\"!", cache_file);
+		//Separators are part of recognized string, glyph cache and classifier may decode cell differently from segment scan
+		disk_config=SsocrDiskCache::HashString(GetCacheConfig(inverted, thresh, thresh_flags, cleanup)+':'+dec_sep+':'+neg_sign+(glyph_cache?":glyphs:":":")+classifier);
+	}
+
+	//Threads are started last: ThrowError skips the destructor, so threads started before it would never be stopped
+	//Publisher thread is started only if metrics file is writable, so it goes before the threads that can't fail
+	if (strlen(metrics_file)>0) {
+		metrics=new SsocrMetrics(metrics_file);
+		if (!metrics->Start())
+			env->ThrowError("SegmentDisplayOCR: error while writing file \"%s\"!", metrics_file);
+	}
+
+	//Strip threads sleep between frames, 0 means all CPUs
+	if (threads!=1) {
+		strips=new SsocrStripPool(threads);
+		ssocr->SetStripPool(strips);
+		strips->SetTrace(trace);
+	}
+
+	if (prefetch>0) {
+		this->prefetch=new AvsPrefetch(child, env);
+		this->prefetch->SetTrace(trace);
+	}
 }
 
 //Filter is destroyed when AVS file is closed
 OCRFilter::~OCRFilter()
 {
+	if (log_sorted) {
+		std::string digits;
+		for (int n=memo->GetNext(0); n>=0; n=memo->GetNext(n+1)) {
+			unsigned int cur_mseconds=timer.GetMseconds(n);
+			memo->Get(n, digits);
+			Log(digits, time_format==TMS?SsocrTimer::GetTimestamp(cur_mseconds):"", cur_mseconds, n, FULL_QUALITY);
+		}
+	}
+	//Checkpoint of finished run is removed, so next run starts over
+	if (checkpoint) {
+		if (last_frame>=GetFinalFrame())
+			checkpoint->Remove();
+		else
+			SaveCheckpoint();
+		delete checkpoint;
+	}
+	//Background thread could be inside of the child clip, so it's stopped first
+	delete prefetch;
+	//Child clip pointer could be reused by other clip after it's destroyed
+	if (shared)
+		SsocrBinCache::GetShared().Purge((void*)child);
+	SsocrDiskCache::Close(disk_cache);
+	delete memo;
+	delete deadline;
+	delete tracker;
 	delete ssocr;
+	delete strips;
+	delete metrics;
+	if (trace) {
+		trace->Dump(trace_file);
+		delete trace;
+	}
 	if (log_file.is_open())
 		log_file.close();
 }
 
-//Rounding algorithm from Java 7
-int OCRFilter::Round(double num)
-{
-	if (num!=0.49999999999999994)
-		return (int)floor(num+0.5);
-	else
-		return 0;
-}
-
 //GetFrame is called only when client or parent filter requests frame
 PVideoFrame __stdcall OCRFilter::GetFrame(int n, IScriptEnvironment *env)
 {
-	PVideoFrame src=child->GetFrame(n, env);
+	SsocrTicks frame_start=SsocrTrace::Start(trace);
+	SsocrTicks stage_start=frame_start;
+	//With prefetch, environment and upstream filters are shared with background thread that works only during recognition
+	AvsUpstreamLock upstream(prefetch);
+	int sample=n;
+	if (sparse)
+		n=timer.GetSampleFrame(n);
+	//Resumed run fast-forwards through logged frames without decoding them, output frames are discarded anyway
+	if (n<=resume_frame&&!debug) {
+		if (prefetch)
+			SchedulePrefetch(sample);
+		SsocrTrace::Stop(trace, "GetFrame", frame_start);
+		return GetSkippedFrame(env);
+	}
+	PVideoFrame src=prefetch?prefetch->GetFrame(n):child->GetFrame(n, env);
+	//Current frame is taken from prefetched ones before they are rescheduled
+	if (prefetch)
+		SchedulePrefetch(sample);
+	SsocrTrace::Stop(trace, "child GetFrame", stage_start);
+	if (metrics)
+		metrics->Add(SsocrMetrics::FRAMES_SEEN);
 	
 	//For the sake of optimization, following variables are computed only ones per iteration
-	unsigned int cur_mseconds=Round(fduration*n);
+	unsigned int cur_mseconds=timer.GetMseconds(n);
 	bool newer=IsNewer(n);
-	bool alarm=CheckTimer(cur_mseconds);
-	std::string timestamp=(debug||(time_format==TMS&&alarm))?GetTimestamp(cur_mseconds):"";
+	bool alarm=sparse||timer.CheckTimer(cur_mseconds);
+	std::string timestamp=(debug||(time_format==TMS&&alarm))?SsocrTimer::GetTimestamp(cur_mseconds):"";
+	std::string digits;
+	bool memoized=alarm&&memo&&memo->Get(n, digits);
+	//At the highest degradation level some of sampled frames aren't recognized
+	if (deadline&&alarm&&!memoized&&(debug||newer)&&deadline->Skip())
+		alarm=false;
 
 	if (debug) {
 		PVideoFrame dst=src;
+		stage_start=SsocrTrace::Start(trace);
 		env->MakeWritable(&dst);	//MakeWritable creates a writable copy of input frame (read-only original remains valid)
-		SsocrImg dst_img(dst, vi);
+		SsocrTrace::Stop(trace, "MakeWritable", stage_start);
+		AvsImg dst_img(dst, vi);
+		stage_start=SsocrTrace::Start(trace);
 		dst_img.MakeMonochrome();
-		if (alarm) {
-			ssocr->Recognize(SsocrImg(src, vi), &dst_img, dec_sep, neg_sign);
-			if (newer)
-				Log(ssocr->GetLastRecognizedDigits(), timestamp, cur_mseconds, n);
+		SsocrTrace::Stop(trace, "MakeMonochrome", stage_start);
+		if (alarm&&!memoized) {
+			upstream.Release(true);
+			Recognize(AvsImg(src, vi), &dst_img, n);
+			upstream.Acquire();
+			if (newer&&!log_sorted)
+				Log(ssocr->GetLastRecognizedDigits(), timestamp, cur_mseconds, n, last_level);
 		}
-		DebugOSD(env, dst, timestamp, ssocr->GetLastRecognizedDigits(), n, newer, alarm);
+		stage_start=SsocrTrace::Start(trace);
+		DebugOSD(env, dst, timestamp, memoized?digits:ssocr->GetLastRecognizedDigits(), n, newer, alarm, memoized);
+		SsocrTrace::Stop(trace, "DebugOSD", stage_start);
+		SsocrTrace::Stop(trace, "GetFrame", frame_start);
 		return dst;
 	} else {
-		if (alarm&&newer) {
-			ssocr->Recognize(SsocrImg(src, vi), NULL, dec_sep, neg_sign);
-			Log(ssocr->GetLastRecognizedDigits(), timestamp, cur_mseconds, n);
+		//With sorted log out of order frames are also recognized, so they are logged at their position later
+		if (alarm&&!memoized&&(newer||log_sorted)) {
+			upstream.Release(true);
+			Recognize(AvsImg(src, vi), NULL, n);
+			upstream.Acquire();
+			if (!log_sorted)
+				Log(ssocr->GetLastRecognizedDigits(), timestamp, cur_mseconds, n, last_level);
 		}
+		if (checkpoint&&newer&&checkpoint->IsDue())
+			SaveCheckpoint();
+		SsocrTrace::Stop(trace, "GetFrame", frame_start);
 		return src;
 	}
 }
 
-void OCRFilter::DebugOSD(IScriptEnvironment *env, PVideoFrame &src, const std::string &timestamp, const std::string &value, int cur_frame, bool newer, bool alarm)
+//Frames are expected to be requested sequentially: next prefetch_depth output frames are fetched from child while this one is recognized
+//In sparse mode these are the next samples, so only frames that will be recognized are decoded ahead
+void OCRFilter::SchedulePrefetch(int n)
 {
-	int textcolor=0xf0f080;	//Orange
-	if (!newer)
-		textcolor=0xf08080;	//Red
-	else if (alarm)
-		textcolor=0x80f080;	//Green
+	std::vector<int> frames;
+	for (int i=n+1; i<=n+prefetch_depth&&i<vi.num_frames; i++) {
+		int frame=sparse?timer.GetSampleFrame(i):i;
+		if (frame>resume_frame||debug)
+			frames.push_back(frame);
+	}
+	prefetch->Schedule(frames);
+}
 
-	std::ostringstream out_str;
-	out_str<<timestamp<<"\nFRAME: "<<cur_frame<<"\n"<<value;
-	env->ApplyMessage(&src, vi, out_str.str().c_str(), vi.width/2, textcolor, 0, 0);
+PVideoFrame OCRFilter::GetSkippedFrame(IScriptEnvironment *env)
+{
+	if (!skipped) {
+		static const int planes[3]={PLANAR_Y, PLANAR_U, PLANAR_V};
+		skipped=env->NewVideoFrame(vi);	//Called from GetFrame under upstream lock
+		for (int p=0; p<3; p++) {
+			unsigned char *ptr=skipped->GetWritePtr(planes[p]);
+			for (int y=0; y<skipped->GetHeight(planes[p]); y++)
+				memset(ptr+y*skipped->GetPitch(planes[p]), p?128:16, skipped->GetRowSize(planes[p]));
+		}
+	}
+	return skipped;
 }
 
-std::string OCRFilter::GetTimestamp(unsigned int cur_mseconds)
+//Log is flushed first, so checkpoint never points past what is actually on disk
+void OCRFilter::SaveCheckpoint()
 {
-	std::ostringstream out_str;
+	log_file.flush();
+	SsocrCheckpoint::State state;
+	state.frame=last_frame;
+	state.log_offset=GetLogSize(log_path.c_str());
+	state.config=checkpoint_config;
+	state.recognizer=ssocr->GetState();
+	if (state.log_offset>=0)
+		checkpoint->Save(state);
+}
 
-	unsigned int dsp_mseconds=cur_mseconds%1000;
-	unsigned int dsp_seconds=cur_mseconds/1000%60;
-	unsigned int dsp_minutes=cur_mseconds/60000%60;
-	unsigned int dsp_hours=cur_mseconds/3600000;
+//Last child frame that is logged
+int OCRFilter::GetFinalFrame()
+{
+	return sparse?timer.GetSampleFrame(vi.num_frames-1):vi.num_frames-1;
+}
 
-	out_str.fill('0');
-	if (dsp_hours>99)
-		out_str<<"EE";
-	else
-		out_str<<std::setw(2)<<dsp_hours;
-	out_str<<':'<<std::setw(2)<<dsp_minutes<<':'<<std::setw(2)<<dsp_seconds<<'.'<<std::setw(3)<<dsp_mseconds;
+bool __stdcall OCRFilter::GetParity(int n)
+{
+	return child->GetParity(sparse?timer.GetSampleFrame(n):n);
+}
 
-	return out_str.str();
+void OCRFilter::Recognize(const SsocrImg &input, SsocrImg *output, int cur_frame)
+{
+	SsocrTicks start=metrics||deadline?SsocrTrace::Now():0;
+	if (deadline)
+		ssocr->SetDegradation(deadline->GetLevel());
+	unsigned long glyph_lookups=ssocr->GetGlyphCache().GetLookups(), glyph_hits=ssocr->GetGlyphCache().GetHits();
+	SsocrImg region(input);
+	SsocrImg region_output(output?*output:input);
+	//Field is processed as frame of half height, so deinterlacing isn't needed
+	if (field>=0) {
+		region.SelectField(field);
+		region_output.SelectField(field);
+	}
+	int x=0, y=0, w=region.GetWidth(), h=region.GetHeight();
+	if (tracker) {
+		SsocrTicks stage_start=SsocrTrace::Start(trace);
+		tracker->Locate(region, x, y, w, h);
+		SsocrTrace::Stop(trace, "locate display", stage_start);
+		region.Crop(x, y, w, h);
+		region_output.Crop(x, y, w, h);
+	}
+	bool cached=false, stored=false;
+	SsocrHash content=0;
+	if (disk_cache) {
+		SsocrTicks stage_start=SsocrTrace::Start(trace);
+		std::string digits;
+		content=SsocrDiskCache::HashLuma(region);
+		//Recognition is skipped entirely, so debug output shows no segments for stored frames
+		if ((stored=disk_cache->Lookup(content, disk_config, digits)))
+			ssocr->SetLastRecognizedDigits(digits);
+		SsocrTrace::Stop(trace, "cache_file lookup", stage_start);
+	}
+	if (shared&&!stored) {
+		cache_key.frame=cur_frame;
+		cache_key.x=x;
+		cache_key.y=y;
+		cache_key.w=w;
+		cache_key.h=h;
+		//Degraded threshold may binarize frame differently
+		if (deadline)
+			cache_key.config=ssocr->GetDegradation()>=FAST_THRESHOLD?cache_config+":fast":cache_config;
+		cached=RecognizeShared(*ssocr, region, output?&region_output:NULL, cache_key, binarized, dec_sep, neg_sign);
+	} else if (!stored)
+		ssocr->Recognize(region, output?&region_output:NULL, dec_sep, neg_sign);
+	//Degraded result isn't persisted, but stored full quality one is still used
+	last_level=stored?FULL_QUALITY:ssocr->GetDegradation();
+	if (disk_cache&&!stored&&ssocr->GetDegradation()==FULL_QUALITY)
+		disk_cache->Insert(content, disk_config, ssocr->GetLastRecognizedDigits());
+	if (tracker) {
+		//Display is searched for on the whole frame again if nothing was found in the tracked region
+		if (ssocr->GetLastRecognizedDigits().empty())
+			tracker->Lose();
+		if (output)
+			region_output.DrawYuvRectangle(0, 0, region_output.GetWidth()-1, region_output.GetHeight()-1, yellow);
+	}
+	if (metrics) {
+		if (cached)
+			metrics->Add(SsocrMetrics::CACHE_HITS);
+		if (stored)
+			metrics->Add(SsocrMetrics::DISK_CACHE_HITS);
+		metrics->Add(SsocrMetrics::GLYPH_LOOKUPS, ssocr->GetGlyphCache().GetLookups()-glyph_lookups);
+		metrics->Add(SsocrMetrics::GLYPH_HITS, ssocr->GetGlyphCache().GetHits()-glyph_hits);
+		metrics->AddLatency(start);
+		metrics->AddResult(ssocr->GetLastRecognizedDigits());
+	}
+	if (memo)
+		memo->Set(cur_frame, ssocr->GetLastRecognizedDigits());
+	if (deadline)
+		deadline->AddFrame(start);
 }
 
-bool OCRFilter::CheckTimer(unsigned int cur_mseconds)
+bool OCRFilter::RecognizeShared(Ssocr &ssocr, const SsocrImg &input, SsocrImg *output, const SsocrBinCache::Key &cache_key, SsocrMask &binarized, const char* dec_sep, const char* neg_sign)
 {
-	if (!timer)
-		return true;
+	double thresh;
+	bool cached=SsocrBinCache::GetShared().Lookup(cache_key, thresh, binarized);
+	if (!cached) {
+		thresh=ssocr.Binarize(input, binarized);
+		SsocrBinCache::GetShared().Insert(cache_key, thresh, binarized);
+	}
+	ssocr.Recognize(input, output, dec_sep, neg_sign, &binarized);
+	return cached;
+}
 
-	unsigned int last_alarm=cur_mseconds-cur_mseconds%timer;
-	if (cur_mseconds>=last_alarm&&cur_mseconds<(last_alarm+Round(fduration)))
-		return true;
-	else
-		return false;
+//Parsed values are used so equivalent threshold strings (e.g. "50" and "50.0") share cached frames
+std::string OCRFilter::GetCacheConfig(bool inverted, double thresh, SsocrThreshold thresh_flags, const char* cleanup)
+{
+	std::ostringstream config;
+	config<<inverted<<':'<<std::setprecision(17)<<thresh<<':'<<thresh_flags<<':'<<cleanup;
+	return config.str();
+}
+
+void OCRFilter::DebugOSD(IScriptEnvironment *env, PVideoFrame &src, const std::string &timestamp, const std::string &value, int cur_frame, bool newer, bool alarm, bool memoized)
+{
+	int textcolor=0xf0f080;	//Orange
+	if (memoized)
+		textcolor=0x80f0f0;	//Cyan
+	else if (!newer)
+		textcolor=0xf08080;	//Red
+	else if (alarm)
+		textcolor=0x80f080;	//Green
+
+	std::ostringstream out_str;
+	out_str<<timestamp<<"\nFRAME: "<<cur_frame<<"\n";
+	if (deadline)
+		out_str<<"LEVEL: "<<deadline->GetLevel()<<"\n";
+	out_str<<value;
+	env->ApplyMessage(&src, vi, out_str.str().c_str(), vi.width/2, textcolor, 0, 0);
 }
 
 bool OCRFilter::IsNewer(int cur_frame)
@@ -188,9 +522,10 @@ bool OCRFilter::IsNewer(int cur_frame)
 	return true;
 }
 
-void OCRFilter::Log(const std::string &digits, const std::string &timestamp, unsigned int cur_mseconds, int cur_frame)
+void OCRFilter::Log(const std::string &digits, const std::string &timestamp, unsigned int cur_mseconds, int cur_frame, int level)
 {
 	if (log_file.is_open()) {
+		SsocrTicks log_start=SsocrTrace::Start(trace);
 		SYSTEMTIME lt;
 		char *rtm_buf;
 		int sdate_len, rtm_len;
@@ -220,42 +555,18 @@ void OCRFilter::Log(const std::string &digits, const std::string &timestamp, uns
 				log_file<<cur_frame;
 				break;
 		}
-		log_file<<csv_sep<<'"'<<digits<<'"'<<std::endl;
+		log_file<<csv_sep<<'"'<<digits<<'"';
+		//Level the digits were recognized at, deadline may have changed current one since
+		if (deadline)
+			log_file<<csv_sep<<level;
+		log_file<<std::endl;
+		SsocrTrace::Stop(trace, "Log", log_start);
 	}
 }
 
-bool OCRFilter::ParseThreshold(std::string threshold, double &thresh, SsocrThreshold &thresh_flags)
-{
-	if (!threshold.length())
-		return false;
-
-	if (std::isalpha(threshold[threshold.length()-1])) {
-		switch (threshold[threshold.length()-1]) {
-			case 'i':
-				thresh_flags=ITERATIVE_THRESHOLD;
-				break;
-			case 'a':
-				thresh_flags=ABSOLUTE_THRESHOLD;
-				break;
-			default:
-				return false;
-				break;
-		}
-		threshold.resize(threshold.length()-1);
-	} else {
-		thresh_flags=ADAPTIVE_THRESHOLD;
-	}
-	std::istringstream iss(threshold);
-	iss>>std::noskipws>>thresh;
-	if (!iss.eof()||iss.fail())
-		return false;
-	else
-		return true;
-}
-
 AVSValue __cdecl OCRFilter::Create(AVSValue args, void* user_data, IScriptEnvironment *env) 
 {
-	return new OCRFilter(args[0].AsClip(), args[1].AsString(OCRF_LOG_FILE), args[2].AsBool(OCRF_LOG_APPEND), args[3].AsInt(OCRF_INTERVAL), args[4].AsString(OCRF_TIME_FORMAT), args[5].AsBool(OCRF_DEBUG), args[6].AsBool(OCRF_LOCALIZED_OUTPUT), args[7].AsBool(OCRF_INVERTED), args[8].AsString(OCRF_THRESHOLD), env);
+	return new OCRFilter(args[0].AsClip(), args[1].AsString(OCRF_LOG_FILE), args[2].AsBool(OCRF_LOG_APPEND), args[3].AsInt(OCRF_INTERVAL), args[4].AsString(OCRF_TIME_FORMAT), args[5].AsBool(OCRF_DEBUG), args[6].AsBool(OCRF_LOCALIZED_OUTPUT), args[7].AsBool(OCRF_INVERTED), args[8].AsString(OCRF_THRESHOLD), args[9].AsString(OCRF_TRACE_FILE), args[10].AsString(OCRF_METRICS_FILE), args[11].AsBool(OCRF_SPARSE), args[12].AsBool(OCRF_MEMOIZE), args[13].AsBool(OCRF_LOG_SORTED), args[14].AsString(OCRF_CLEANUP), args[15].AsInt(OCRF_CACHE_SIZE), args[16].AsBool(OCRF_TRACK), args[17].AsInt(OCRF_THREADS), args[18].AsInt(OCRF_PREFETCH), args[19].AsString(OCRF_CACHE_FILE), args[20].AsString(OCRF_CHECKPOINT), args[21].AsInt(OCRF_GLYPH_CACHE), args[22].AsString(OCRF_CLASSIFIER), args[23].AsFloat(OCRF_BUDGET), args[24].AsInt(OCRF_FIELD), env);
 }
 
 AVSValue __cdecl OCRFilter::Runtime(AVSValue args, void* user_data, IScriptEnvironment *env)
@@ -280,21 +591,49 @@ AVSValue __cdecl OCRFilter::Runtime(AVSValue args, void* user_data, IScriptEnvir
 
 	double thresh;
 	SsocrThreshold thresh_flags;
-	if (!ParseThreshold(args[2].AsString(OCRF_THRESHOLD), thresh, thresh_flags))
+	if (!Ssocr::ParseThreshold(args[2].AsString(OCRF_THRESHOLD), thresh, thresh_flags))
 		env->ThrowError("RtmSegmentDisplayOCR: unrecognized threshold string \"%s\"!", args[2].AsString(OCRF_THRESHOLD));
 	if (thresh<0.0||thresh>100.0)
 		env->ThrowError("RtmSegmentDisplayOCR: threshold should be between 0 and 100!");
 
+	Ssocr ssocr(!args[1].AsBool(OCRF_INVERTED), thresh, thresh_flags);
+	if (!ssocr.SetCleanup(args[3].AsString(OCRF_CLEANUP)))
+		env->ThrowError("RtmSegmentDisplayOCR: unrecognized cleanup string \"%s\"!", args[3].AsString(OCRF_CLEANUP));
+
+	int cache_size=args[4].AsInt(OCRF_CACHE_SIZE);
+	if (cache_size<0)
+		env->ThrowError("RtmSegmentDisplayOCR: cache_size can't be negative number!");
+	bool cached=false;
+	if (cache_size>0) {
+		//Frames are only taken from the cache: they are inserted and purged by SegmentDisplayOCR instances that hold their source clip
+		//RtmSegmentDisplayOCR has no lifetime of its own to purge entries, and clip address may be reused after the script is reloaded
+		SsocrBinCache::Key cache_key;
+		cache_key.source=(void*)child;
+		cache_key.context=env;
+		cache_key.frame=cn.AsInt();
+		cache_key.x=0;
+		cache_key.y=0;
+		cache_key.w=vi.width;
+		cache_key.h=vi.height;
+		cache_key.config=GetCacheConfig(args[1].AsBool(OCRF_INVERTED), thresh, thresh_flags, args[3].AsString(OCRF_CLEANUP));
+		double cached_thresh;
+		SsocrMask binarized;
+		if ((cached=SsocrBinCache::GetShared().Lookup(cache_key, cached_thresh, binarized)))
+			ssocr.Recognize(AvsImg(src, vi), NULL, ".", "-", &binarized);
+	}
+	if (!cached)
+		ssocr.Recognize(AvsImg(src, vi), NULL, ".", "-");
+
 	//AVSValue doesn't make an internal copy of string - it simply stores a pointer to it
 	//SaveString copies string into ScriptEnvironment object so AVSValue string remains valid after function returns
 	//SaveString frees saved strings only when AVS file is closed - it will eat up memory if used too often
-	return env->SaveString(Ssocr(!args[1].AsBool(OCRF_INVERTED), thresh, thresh_flags).Recognize(SsocrImg(src, vi), NULL, ".", "-").GetLastRecognizedDigits().c_str());
+	return env->SaveString(ssocr.GetLastRecognizedDigits().c_str());
 }
 
 extern "C" __declspec(dllexport) const char* __stdcall AvisynthPluginInit3(IScriptEnvironment *env, const AVS_Linkage *vectors) 
 {
 	AVS_linkage=vectors;
-	env->AddFunction("SegmentDisplayOCR", "c[log_file]s[log_append]b[interval]i[time_format]s[debug]b[localized_output]b[inverted]b[threshold]s", OCRFilter::Create, NULL);
-	env->AddFunction("RtmSegmentDisplayOCR", "c[inverted]b[threshold]s", OCRFilter::Runtime, NULL);
+	env->AddFunction("SegmentDisplayOCR", "c[log_file]s[log_append]b[interval]i[time_format]s[debug]b[localized_output]b[inverted]b[threshold]s[trace_file]s[metrics_file]s[sparse]b[memoize]b[log_sorted]b[cleanup]s[cache_size]i[track]b[threads]i[prefetch]i[cache_file]s[checkpoint]s[glyph_cache]i[classifier]s[budget]f[field]i", OCRFilter::Create, NULL);
+	env->AddFunction("RtmSegmentDisplayOCR", "c[inverted]b[threshold]s[cleanup]s[cache_size]i", OCRFilter::Runtime, NULL);
 	return "SegmentDisplayOCR " OCRF_VERSION_STRING;
 }
\ No newline at end of file
@@ -16,16 +16,27 @@
 
 #include <string>
 #include "ssocr.h"
+#include "ssocr_timer.h"
+#include "ssocr_trace.h"
+#include "ssocr_metrics.h"
+#include "ssocr_memo.h"
+#include "ssocr_bincache.h"
+#include "ssocr_diskcache.h"
+#include "ssocr_checkpoint.h"
+#include "ssocr_tracker.h"
+#include "ssocr_deadline.h"
+#include "avsprefetch.h"
 #include "avisynth.h"
 
 class OCRFilter: public GenericVideoFilter {
 private: 
 	enum TFEnum {TMS, RTM, SEC, MSEC, FRAME};
-	double fduration;			//Frame duration in mseconds
-	unsigned int timer;			//Timer in mseconds
+	SsocrTimer timer;
 	int last_frame;				//Last processed frame
 	TFEnum time_format;
 	bool debug;
+	bool sparse;				//Output clip contains only sampled frames
+	bool log_sorted;			//Log is written from memo when filter is destroyed
 	std::ofstream log_file;
 	char csv_sep[4];
 	char dec_sep[4];
@@ -33,20 +44,47 @@ private:
 	char sdate_fmt[80];
 	char time_fmt[80];
 	Ssocr *ssocr;
+	SsocrTrace *trace;			//NULL if tracing is disabled
+	std::string trace_file;
+	SsocrMetrics *metrics;		//NULL if metrics are disabled
+	SsocrMemo *memo;			//NULL if memoization is disabled
+	bool shared;				//Binarized frames are shared with other recognizers through SsocrBinCache
+	SsocrBinCache::Key cache_key;
+	std::string cache_config;	//Config of cache_key at full quality
+	SsocrMask binarized;
+	SsocrDiskCache *disk_cache;	//NULL if results aren't persisted
+	SsocrHash disk_config;		//Hash of settings that affect recognized string
+	SsocrTracker *tracker;		//NULL if display isn't tracked
+	SsocrStripPool *strips;		//NULL if frame is processed by the calling thread only
+	AvsPrefetch *prefetch;		//NULL if frames aren't prefetched
+	int prefetch_depth;
+	SsocrCheckpoint *checkpoint;	//NULL if progress isn't saved
+	std::string checkpoint_config;	//Settings that affect the log, checkpoint of different run isn't resumed
+	std::string log_path;
+	int resume_frame;			//Frames up to this one were logged before restart and aren't decoded again
+	PVideoFrame skipped;		//Blank frame returned instead of them
+	SsocrDeadline *deadline;	//NULL if recognition time isn't limited
+	int last_level;				//Degradation level last digits were recognized at, 0 if they were taken from cache_file
+	int field;					//Recognized field of interlaced frame (0 - even lines, 1 - odd lines), -1 for whole frame
 
-	int Round(double num);
-	std::string GetTimestamp(unsigned int cur_mseconds);
-	bool CheckTimer(unsigned int cur_mseconds);
 	bool IsNewer(int cur_frame);
-	void DebugOSD(IScriptEnvironment *env, PVideoFrame &src, const std::string &timestamp, const std::string &value, int cur_frame, bool newer, bool alarm);
-	void Log(const std::string &digits, const std::string &timestamp, unsigned int cur_mseconds, int cur_frame);
-	static bool ParseThreshold(std::string threshold, double &thresh, SsocrThreshold &thresh_flags);
+	void SchedulePrefetch(int n);
+	PVideoFrame GetSkippedFrame(IScriptEnvironment *env);
+	void SaveCheckpoint();
+	int GetFinalFrame();
+	void Recognize(const SsocrImg &input, SsocrImg *output, int cur_frame);
+	void DebugOSD(IScriptEnvironment *env, PVideoFrame &src, const std::string &timestamp, const std::string &value, int cur_frame, bool newer, bool alarm, bool memoized);
+	void Log(const std::string &digits, const std::string &timestamp, unsigned int cur_mseconds, int cur_frame, int level);
+	//Binarizes frame of cache_key or takes it from the shared cache, returns true if it was cached
+	static bool RecognizeShared(Ssocr &ssocr, const SsocrImg &input, SsocrImg *output, const SsocrBinCache::Key &cache_key, SsocrMask &binarized, const char* dec_sep, const char* neg_sign);
+	static std::string GetCacheConfig(bool inverted, double thresh, SsocrThreshold thresh_flags, const char* cleanup);
 public:
-	OCRFilter(PClip child, const char* log_file, bool log_append, int interval, const char* time_format, bool debug, bool localized_output, bool inverted, const char* threshold, IScriptEnvironment *env);
+	OCRFilter(PClip child, const char* log_file, bool log_append, int interval, const char* time_format, bool debug, bool localized_output, bool inverted, const char* threshold, const char* trace_file, const char* metrics_file, bool sparse, bool memoize, bool log_sorted, const char* cleanup, int cache_size, bool track, int threads, int prefetch, const char* cache_file, const char* checkpoint, int glyph_cache, const char* classifier, double budget, int field, IScriptEnvironment *env);
 	~OCRFilter();
 
 	//Overloaded functions:
 	PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment *env);
+	bool __stdcall GetParity(int n);
 	//SetCacheHints and GetVersion are already properly defined in GenericVideoFilter and IClip respectively
 	//GetVersion will return AVISYNTH_INTERFACE_VERSION of current AviSynth C++ API (avisynth.h) so AviSynth won't load this plugin if it has incompatible API version
 
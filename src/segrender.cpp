@@ -0,0 +1,209 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "ssocr_defines.h"
+#include "segrender.h"
+
+/* glyph geometry in units of digit height */
+#define SEG_DIGIT_WIDTH 0.5
+#define SEG_THICKNESS 0.125
+#define SEG_GAP 0.2
+#define SEG_COLON_UP 0.3
+#define SEG_COLON_DOWN 0.65
+
+SegRender::SegRender(const Params &params):
+	params(params), buffer(), blur_buffer(), planes(), rand_state(params.seed)
+{
+	for (int p=0; p<3; p++) {
+		planes[p].width_sub=p?1:0;
+		planes[p].height_sub=p?1:0;
+		planes[p].width=(params.width+(1<<planes[p].width_sub)-1)>>planes[p].width_sub;
+		planes[p].height=(params.height+(1<<planes[p].height_sub)-1)>>planes[p].height_sub;
+		planes[p].pitch=planes[p].width;
+		planes[p].bit_depth=8;
+	}
+	buffer.resize(GetFrameSize());
+	planes[0].ptr=&buffer[0];
+	planes[1].ptr=planes[0].ptr+planes[0].pitch*planes[0].height;
+	planes[2].ptr=planes[1].ptr+planes[1].pitch*planes[1].height;
+}
+
+int SegRender::GetSegments(char c)
+{
+	switch (c) {
+		case '0': return D_ZERO;
+		case '1': return D_ONE;
+		case '2': return D_TWO;
+		case '3': return D_THREE;
+		case '4': return D_FOUR;
+		case '5': return D_FIVE;
+		case '6': return D_SIX;
+		case '7': return D_SEVEN;
+		case '8': return D_EIGHT;
+		case '9': return D_NINE;
+		case 'a': return D_HEX_A;
+		case 'b': return D_HEX_b;
+		case 'c': return D_HEX_C;
+		case 'd': return D_HEX_d;
+		case 'e': return D_HEX_E;
+		case 'f': return D_HEX_F;
+		case '.': return D_DECIMAL;
+		case '-': return D_MINUS;
+		case ':': return D_COLON;
+		default: return -1;
+	}
+}
+
+bool SegRender::Render(const std::string &text)
+{
+	double units=0.0;
+
+	for (std::string::const_iterator it=text.begin(); it!=text.end(); it++) {
+		int segs=GetSegments(*it);
+		if (segs<0)
+			return false;
+		units+=(segs==D_DECIMAL||segs==D_COLON?SEG_THICKNESS:SEG_DIGIT_WIDTH)+SEG_GAP;
+	}
+
+	/* fit the text into 90% of frame width and 60% of frame height */
+	int dh=std::min(params.height*6/10, (int)(params.width*0.9/(units+fabs(params.skew))));
+	int dw=(int)(dh*SEG_DIGIT_WIDTH);
+	int t=std::max(1, (int)(dh*SEG_THICKNESS));
+	int gap=std::max(2, (int)(dh*SEG_GAP));
+	int total=0;
+	for (std::string::const_iterator it=text.begin(); it!=text.end(); it++)
+		total+=(GetSegments(*it)==D_DECIMAL||GetSegments(*it)==D_COLON?t:dw)+gap;
+	total-=gap;
+
+	unsigned char bg=params.inverted?16:235;
+	unsigned char fg=params.inverted?235:16;
+	std::fill(planes[0].ptr, planes[0].ptr+planes[0].pitch*planes[0].height, bg);
+	std::fill(planes[1].ptr, planes[1].ptr+2*planes[1].pitch*planes[1].height, (unsigned char)128);
+
+	int x=(params.width-total-(int)(params.skew*dh))/2;
+	int y=(params.height-dh)/2;
+	int baseline=y+dh;
+	for (std::string::const_iterator it=text.begin(); it!=text.end(); it++) {
+		int segs=GetSegments(*it);
+		switch (segs) {
+			case D_DECIMAL:
+				FillRect(x, y+dh-t, t, t, baseline, fg);
+				x+=t+gap;
+				continue;
+			case D_COLON:
+				FillRect(x, y+(int)(dh*SEG_COLON_UP), t, t, baseline, fg);
+				FillRect(x, y+(int)(dh*SEG_COLON_DOWN), t, t, baseline, fg);
+				x+=t+gap;
+				continue;
+			case D_MINUS:
+				segs=HORIZ_MID;
+				break;
+		}
+		if (segs&HORIZ_UP) FillRect(x, y, dw, t, baseline, fg);
+		if (segs&HORIZ_MID) FillRect(x, y+(dh-t)/2, dw, t, baseline, fg);
+		if (segs&HORIZ_DOWN) FillRect(x, y+dh-t, dw, t, baseline, fg);
+		if (segs&VERT_LEFT_UP) FillRect(x, y, t, dh/2, baseline, fg);
+		if (segs&VERT_RIGHT_UP) FillRect(x+dw-t, y, t, dh/2, baseline, fg);
+		if (segs&VERT_LEFT_DOWN) FillRect(x, y+dh/2, t, dh-dh/2, baseline, fg);
+		if (segs&VERT_RIGHT_DOWN) FillRect(x+dw-t, y+dh/2, t, dh-dh/2, baseline, fg);
+		x+=dw+gap;
+	}
+
+	if (params.blur>0)
+		BoxBlur();
+	if (params.noise>0)
+		AddNoise();
+
+	return true;
+}
+
+/* rectangle is sheared to the right by skew pixels per line above the baseline */
+void SegRender::FillRect(int x, int y, int w, int h, int baseline, unsigned char lum)
+{
+	for (int yi=std::max(y, 0); yi<y+h&&yi<params.height; yi++) {
+		int shift=(int)floor(params.skew*(baseline-yi)+0.5);
+		int x1=std::max(x+shift, 0);
+		int x2=std::min(x+shift+w, params.width);
+		if (x1<x2)
+			std::fill(planes[0].ptr+planes[0].pitch*yi+x1, planes[0].ptr+planes[0].pitch*yi+x2, lum);
+	}
+}
+
+/* separable box blur of luma plane with running sums, edges are clamped */
+void SegRender::BoxBlur()
+{
+	int r=params.blur;
+	int w=params.width;
+	int h=params.height;
+	int div=2*r+1;
+	unsigned char *lum=planes[0].ptr;
+
+	blur_buffer.resize(w*h);
+
+	for (int y=0; y<h; y++) {
+		unsigned char *src=lum+planes[0].pitch*y;
+		unsigned char *dst=&blur_buffer[w*y];
+		int sum=0;
+		for (int i=-r; i<=r; i++)
+			sum+=src[std::min(std::max(i, 0), w-1)];
+		for (int x=0; x<w; x++) {
+			dst[x]=sum/div;
+			sum+=src[std::min(x+r+1, w-1)]-src[std::max(x-r, 0)];
+		}
+	}
+
+	for (int x=0; x<w; x++) {
+		int sum=0;
+		for (int i=-r; i<=r; i++)
+			sum+=blur_buffer[w*std::min(std::max(i, 0), h-1)+x];
+		for (int y=0; y<h; y++) {
+			lum[planes[0].pitch*y+x]=sum/div;
+			sum+=blur_buffer[w*std::min(y+r+1, h-1)+x]-blur_buffer[w*std::max(y-r, 0)+x];
+		}
+	}
+}
+
+void SegRender::AddNoise()
+{
+	for (int y=0; y<params.height; y++) {
+		unsigned char *row=planes[0].ptr+planes[0].pitch*y;
+		for (int x=0; x<params.width; x++) {
+			/* LCG from Numerical Recipes, upper bits are used */
+			rand_state=rand_state*1664525+1013904223;
+			int lum=row[x]+(int)((rand_state>>16)%(2*params.noise+1))-params.noise;
+			row[x]=lum<0?0:(lum>MAXRGB?MAXRGB:lum);
+		}
+	}
+}
+
+const YuvImg::PlaneData *SegRender::GetPlanes() const
+{
+	return planes;
+}
+
+void SegRender::CopyTo(unsigned char *buf, YuvImg::PlaneData *planes) const
+{
+	memcpy(buf, &buffer[0], buffer.size());
+	for (int p=0; p<3; p++) {
+		planes[p]=this->planes[p];
+		planes[p].ptr=buf+(this->planes[p].ptr-&buffer[0]);
+	}
+}
+
+size_t SegRender::GetFrameSize() const
+{
+	return planes[0].pitch*planes[0].height+2*planes[1].pitch*planes[1].height;
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SEGRENDER_H
+#define SEGRENDER_H
+
+#include <string>
+#include <vector>
+#include "yuvimg.h"
+
+//Procedural seven-segment display renderer for benchmarks
+//Draws strings of 0-9, a-f, decimal point, minus and colon into YV12 frame
+class SegRender {
+public:
+	struct Params {
+		int width;
+		int height;
+		bool inverted;			//White digits on black background
+		int noise;				//Amplitude of uniform luma noise (0-255)
+		int blur;				//Radius of box blur
+		double skew;			//Horizontal shift per line (italic digits), in pixels
+		unsigned int seed;		//Noise seed
+	};
+private:
+	Params params;
+	std::vector<unsigned char> buffer;
+	std::vector<unsigned char> blur_buffer;
+	YuvImg::PlaneData planes[3];
+	unsigned int rand_state;
+
+	void FillRect(int x, int y, int w, int h, int baseline, unsigned char lum);
+	void BoxBlur();
+	void AddNoise();
+	static int GetSegments(char c);
+public:
+	SegRender(const Params &params);
+	//Returns false if text contains unsupported characters
+	bool Render(const std::string &text);
+	const YuvImg::PlaneData *GetPlanes() const;
+	//Copies rendered frame to caller-owned buffer of GetFrameSize bytes and returns it's planes
+	void CopyTo(unsigned char *buf, YuvImg::PlaneData *planes) const;
+	size_t GetFrameSize() const;
+};
+
+#endif //SEGRENDER_H
\ No newline at end of file
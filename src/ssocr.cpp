@@ -13,7 +13,10 @@
 * along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include <windows.h>
+#include <cctype>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
 #include "ssocr.h"
 
 const unsigned char Ssocr::red[3]={76, 84, 255};
@@ -21,54 +24,239 @@ const unsigned char Ssocr::blue[3]={29, 255, 107};
 const unsigned char Ssocr::green[3]={149, 43, 21};
 const unsigned char Ssocr::gray[3]={127, 128, 128};
 
+/* pixel sources of recognition kernel: Get returns 1 for set (digit) pixel and 0 otherwise,
+* CountRow adds set pixels of the row span [x1,x2] to per-column counters, CountSpan counts them */
+
+/* luminance compared with global threshold, sample type (8 or 16 bits) and polarity are resolved at compile time */
+template <class Sample, bool BLACK_ON_WHITE>
+class LumaPixels {
+private:
+	const unsigned char *ptr;
+	int pitch;
+	int limit; /* integer luminance is below threshold if it's below threshold rounded up */
+
+	int IsSet(Sample lum) const { return BLACK_ON_WHITE?lum<limit:lum>=limit; }
+public:
+	LumaPixels(const SsocrImg &img, double threshold):
+		ptr(img.GetPlanes()[0].ptr), pitch(img.GetPlanes()[0].pitch), limit((int)ceil(threshold/100.0*img.GetMaxLuma())) {}
+	int Get(int x, int y) const { return IsSet(((const Sample*)(ptr+pitch*y))[x]); }
+	void CountRow(int y, int x1, int x2, int *counts) const
+	{
+		const Sample *row=(const Sample*)(ptr+pitch*y);
+		for (int x=x1; x<=x2; x++)
+			counts[x]+=IsSet(row[x]);
+	}
+	int CountSpan(int y, int x1, int x2) const
+	{
+		const Sample *row=(const Sample*)(ptr+pitch*y);
+		int count=0;
+		for (int x=x1; x<=x2; x++)
+			count+=IsSet(row[x]);
+		return count;
+	}
+};
+
+/* binarized mask (local threshold, cleanup or shared cache), the rest of the word is skipped when it has no set pixels left */
+class MaskPixels {
+private:
+	const SsocrMask &mask;
+public:
+	MaskPixels(const SsocrMask &mask): mask(mask) {}
+	int Get(int x, int y) const { return mask.Get(x, y); }
+	void CountRow(int y, int x1, int x2, int *counts) const
+	{
+		const MaskWord *row=mask.GetRow(y);
+		for (int x=x1; x<=x2;) {
+			int end=(x/MASK_WORD_BITS+1)*MASK_WORD_BITS;
+			if (end>x2+1)
+				end=x2+1;
+			for (MaskWord word=row[x/MASK_WORD_BITS]>>(x%MASK_WORD_BITS); word&&x<end; x++, word>>=1)
+				counts[x]+=(int)(word&1);
+			x=end;
+		}
+	}
+	int CountSpan(int y, int x1, int x2) const
+	{
+		const MaskWord *row=mask.GetRow(y);
+		int count=0;
+		for (int x=x1; x<=x2;) {
+			int end=(x/MASK_WORD_BITS+1)*MASK_WORD_BITS;
+			if (end>x2+1)
+				end=x2+1;
+			for (MaskWord word=row[x/MASK_WORD_BITS]>>(x%MASK_WORD_BITS); word&&x<end; x++, word>>=1)
+				count+=(int)(word&1);
+			x=end;
+		}
+		return count;
+	}
+};
+
+/* projection profiles are computed in strips: column counts of every strip are merged, rows of every digit are counted
+* by the strip they belong to, counters of different strips are on different cache lines except at strip boundaries */
+template <class Pixels>
+class ColumnProfileTask: public SsocrStripTask {
+private:
+	const Pixels &pixels;
+	int w;
+	int step; /* every step-th row is counted */
+public:
+	std::vector<int> &counts; /* w counters of every strip */
+
+	ColumnProfileTask(const Pixels &pixels, int w, int step, int strips, std::vector<int> &counts): pixels(pixels), w(w), step(step), counts(counts)
+	{
+		counts.assign(w*strips, 0);
+	}
+	void Run(int strip, int y1, int y2)
+	{
+		for (int j=(y1+step-1)/step*step; j<y2; j+=step)
+			pixels.CountRow(j, 0, w-1, &counts[w*strip]);
+	}
+};
+
+template <class Pixels>
+class RowProfileTask: public SsocrStripTask {
+private:
+	const Pixels &pixels;
+	int h;
+	const std::vector<int> &x1, &x2; /* column span of every digit */
+public:
+	std::vector<int> &counts; /* h counters of every digit */
+
+	RowProfileTask(const Pixels &pixels, int h, const std::vector<int> &x1, const std::vector<int> &x2, std::vector<int> &counts): pixels(pixels), h(h), x1(x1), x2(x2), counts(counts)
+	{
+		counts.resize(h*x1.size());
+	}
+	void Run(int strip, int y1, int y2)
+	{
+		for (size_t d=0; d<x1.size(); d++)
+			for (int j=y1; j<y2; j++)
+				counts[h*d+j]=pixels.CountSpan(j, x1[d], x2[d]);
+	}
+};
+
 Ssocr::Ssocr(bool black_on_white, double thresh, SsocrThreshold thresh_flags):
-	thresh(thresh), thresh_flags(thresh_flags), black_on_white(black_on_white), recognized_digits()
+	thresh(thresh), thresh_flags(thresh_flags), black_on_white(black_on_white), recognized_digits(), trace(NULL), pool(NULL), mask(), mask_scratch(), cleanup(), column_pixels(), strip_pixels(), digit_x1(), digit_x2(), glyphs(), glyph_keys(), classifier(SCANLINE_CLASSIFIER), templates(), degradation(FULL_QUALITY), temporal()
 {}
 
-Ssocr& Ssocr::Recognize(const SsocrImg &input, SsocrImg *output, const char* dec_sep, const char* neg_sign)
+/* adapt threshold to image and binarize it to target mask if it's needed for local threshold or cleanup */
+double Ssocr::threshold_image(SsocrImg &input, SsocrMask &target)
+{
+	double abs_thresh; /* absolute threshold */
+	SsocrTicks stage_start; /* start of traced stage */
+
+	stage_start=SsocrTrace::Start(trace);
+	if (thresh_flags==TEMPORAL_THRESHOLD) {
+		abs_thresh=temporal_threshold(input);
+	} else if (thresh_flags==SAUVOLA_THRESHOLD||thresh_flags==NIBLACK_THRESHOLD) {
+		input.local_threshold(target, thresh, thresh_flags, black_on_white);
+		input.set_mask(&target);
+		abs_thresh=thresh;
+	} else if ((thresh_flags==ADAPTIVE_THRESHOLD||thresh_flags==ITERATIVE_THRESHOLD)&&degradation>=FAST_THRESHOLD) {
+		/* degraded frame is thresholded adaptively by sparsely sampled luminance range */
+		double minval, maxval;
+		input.get_range(DEADLINE_RANGE_STEP, 0, 0, -1, -1, minval, maxval);
+		abs_thresh=(minval+thresh/100.0*(maxval-minval))*100/input.GetMaxLuma();
+	} else {
+		abs_thresh=input.adapt_threshold(thresh, 0, 0, -1, -1, thresh_flags);
+	}
+	SsocrTrace::Stop(trace, "adapt_threshold", stage_start);
+
+	/* remove noise from binarized image before segmentation */
+	if (!cleanup.empty()) {
+		stage_start=SsocrTrace::Start(trace);
+		if (thresh_flags!=SAUVOLA_THRESHOLD&&thresh_flags!=NIBLACK_THRESHOLD)
+			input.binarize(target, abs_thresh, black_on_white);
+		target.Apply(cleanup, mask_scratch);
+		input.set_mask(&target);
+		SsocrTrace::Stop(trace, "cleanup", stage_start);
+	}
+
+	return abs_thresh;
+}
+
+double Ssocr::Binarize(const SsocrImg &source, SsocrMask &binarized)
+{
+	SsocrImg input(source);
+	input.set_pool(pool);
+	double abs_thresh=threshold_image(input, binarized);
+
+	/* global threshold without cleanup is applied to luminance directly, so mask is made only here */
+	if (cleanup.empty()&&thresh_flags!=SAUVOLA_THRESHOLD&&thresh_flags!=NIBLACK_THRESHOLD) {
+		SsocrTicks stage_start=SsocrTrace::Start(trace);
+		input.binarize(binarized, abs_thresh, black_on_white);
+		SsocrTrace::Stop(trace, "binarize", stage_start);
+	}
+
+	return abs_thresh;
+}
+
+template <class Pixels>
+void Ssocr::find_digits(const Pixels &pixels, int w, int h, SsocrImg *output, std::vector<digit_struct> &digits)
+{
+	if (output)
+		find_digits_kernel<Pixels, true>(pixels, w, h, output, digits);
+	else
+		find_digits_kernel<Pixels, false>(pixels, w, h, output, digits);
+}
+
+/* bit of every grid cell is taken from the pixel in it's center */
+template <class Pixels>
+void Ssocr::fingerprint(const Pixels &pixels, const digit_struct &digit, int max_dig_h, SsocrGlyphCache::Key &key)
+{
+	for (int i=0; i<GLYPH_W*GLYPH_H/32; i++)
+		key.bits[i]=0;
+	for (int gy=0; gy<GLYPH_H; gy++) {
+		int j=digit.y1+(2*gy+1)*(digit.h+1)/(2*GLYPH_H);
+		for (int gx=0; gx<GLYPH_W; gx++)
+			if (pixels.Get(digit.x1+(2*gx+1)*(digit.w+1)/(2*GLYPH_W), j))
+				key.bits[(GLYPH_W*gy+gx)/32]|=1u<<((GLYPH_W*gy+gx)%32);
+	}
+	key.w=digit.w;
+	key.h=digit.h;
+	key.max_h=max_dig_h;
+}
+
+/* DEBUG is true if output is set, checks for debug drawing are resolved at compile time */
+template <class Pixels, bool DEBUG>
+void Ssocr::find_digits_kernel(const Pixels &pixels, int w, int h, SsocrImg *output, std::vector<digit_struct> &digits)
 {
 	int number_of_digits=0; /* found this number of digits */
-	int w, h; /* width, height */
 	SsocrStates col=UNKNOWN; /* is column dark or light? */
 	SsocrStates row=UNKNOWN; /* is row dark or light? */
 	int max_dig_h=0, max_dig_w=0; /* maximum height & width of digits found */
 	bool find_dark; /* state of search */
 	int found_pixels=0; /* how many pixels are already found */
-	double abs_thresh; /* absolute threshold */
-
-	std::vector<digit_struct> digits; /* position of digits in image */
-	recognized_digits.clear();
-
-	/* adapt threshold to image */
-	abs_thresh=input.adapt_threshold(thresh, 0, 0, -1, -1, thresh_flags);
-
-	/* get image parameters */
-	w=input.GetWidth();
-	h=input.GetHeight();
-	if (output&&(output->GetHeight()!=h||output->GetWidth()!=w))
-		return *this;
+	SsocrTicks stage_start; /* start of traced stage */
 
 	/* horizontal partition */
+	stage_start=SsocrTrace::Start(trace);
+	/* dark pixels of all columns are counted row by row, so the plane is read sequentially */
+	int step=degradation>=SUBSAMPLED_ROWS?DEADLINE_ROW_STEP:1;
+	int rows=(h+step-1)/step; /* rows that are counted */
+	int strips=SsocrStripPool::GetStripCount(pool, h);
+	ColumnProfileTask<Pixels> column_task(pixels, w, step, strips, strip_pixels);
+	SsocrStripPool::Run(pool, column_task, h, "column profile strip");
+	column_pixels.assign(strip_pixels.begin(), strip_pixels.begin()+w);
+	for (int s=1; s<strips; s++)
+		for (int i=0; i<w; i++)
+			column_pixels[i]+=strip_pixels[w*s+i];
 	find_dark=true;
 	for (int i=0; i<w; i++) {
 		/* check if column is completely light or not */
-		col=UNKNOWN;
-		found_pixels=0;
-		for (int j=0; j<h; j++) {
-			if (input.is_pixel_set(i, j, abs_thresh, black_on_white)) { /* dark */
-				found_pixels++;
-				if (found_pixels>IGNORE_PIXELS) /* 1 dark pixels darken the whole column */
-					col=DARK;
-			} else if (col==UNKNOWN) /* light */
-				col=LIGHT;
-		}
+		found_pixels=column_pixels[i];
+		if (found_pixels>IGNORE_PIXELS) /* 1 dark pixels darken the whole column */
+			col=DARK;
+		else if (found_pixels<rows) /* light */
+			col=LIGHT;
+		else
+			col=UNKNOWN;
 		/* save digit position and draw partition line for DEBUG */
 		if (find_dark&&col==DARK) {
 			/* beginning of digit */
 			digits.push_back(digit_struct());
 			digits[number_of_digits].x1=i;
 			digits[number_of_digits].y1=0;
-			if (output)
+			if (DEBUG)
 				output->DrawYuvVerticalLine(i, 0, h-1, red); /* red line for start of digit */
 			find_dark=false;
 		} else if (!find_dark&&col==LIGHT) {
@@ -76,7 +264,7 @@ Ssocr& Ssocr::Recognize(const SsocrImg &input, SsocrImg *output, const char* dec
 			digits[number_of_digits].x2=i;
 			digits[number_of_digits].y2=h-1;
 			number_of_digits++;
-			if (output)
+			if (DEBUG)
 				output->DrawYuvVerticalLine(i, 0, h-1, blue); /* blue line for end of digit */
 			find_dark=true;
 		}
@@ -92,36 +280,44 @@ Ssocr& Ssocr::Recognize(const SsocrImg &input, SsocrImg *output, const char* dec
 		number_of_digits++;
 		find_dark=true;
 	}
+	SsocrTrace::Stop(trace, "horizontal partition", stage_start);
 
 	/* find upper and lower boundaries of every digit */
+	stage_start=SsocrTrace::Start(trace);
+	/* dark pixels of every row of every digit are counted before rows are scanned */
+	digit_x1.resize(number_of_digits);
+	digit_x2.resize(number_of_digits);
+	for (int d=0; d<number_of_digits; d++) {
+		digit_x1[d]=digits[d].x1;
+		digit_x2[d]=digits[d].x2;
+	}
+	RowProfileTask<Pixels> row_task(pixels, h, digit_x1, digit_x2, strip_pixels);
+	SsocrStripPool::Run(pool, row_task, h, "row profile strip");
 	for (int d=0; d<number_of_digits; d++) {
 		bool found_top=false;
 		find_dark=true;
 		/* start from top of image and scan rows for dark pixel(s) */
 		for (int j=0; j<h; j++) {
-			row=UNKNOWN;
-			found_pixels=0;
 			/* is row dark or light? */
-			for (int i=digits[d].x1; i<=digits[d].x2; i++) {
-				if (input.is_pixel_set(i, j, abs_thresh, black_on_white)) { /* dark */
-					found_pixels++;
-					if (found_pixels>IGNORE_PIXELS) /* 1 pixels darken row */
-						row=DARK;
-				} else if (row==UNKNOWN)
-					row=LIGHT;
-			}
+			found_pixels=strip_pixels[h*d+j];
+			if (found_pixels>IGNORE_PIXELS) /* 1 pixels darken row */
+				row=DARK;
+			else if (found_pixels<=digits[d].x2-digits[d].x1)
+				row=LIGHT;
+			else
+				row=UNKNOWN;
 			/* save position of digit and draw partition line for DEBUG */
 			if (find_dark&&row==DARK) {
 				if (found_top) { /* then we are searching for the bottom */
 					digits[d].y2=j;
 					find_dark=false;
-					if (output)
+					if (DEBUG)
 						output->DrawYuvHorizontalLine(digits[d].x1, digits[d].x2, digits[d].y2, green); /* green line */
 				} else { /* found the top line */
 					digits[d].y1=j;
 					found_top=true;
 					find_dark=false;
-					if (output)
+					if (DEBUG)
 						output->DrawYuvHorizontalLine(digits[d].x1, digits[d].x2, digits[d].y1, green); /* green line */
 				}
 			} else if (!find_dark&&row==LIGHT) {
@@ -129,7 +325,7 @@ Ssocr& Ssocr::Recognize(const SsocrImg &input, SsocrImg *output, const char* dec
 				* dark */
 				digits[d].y2=j;
 				find_dark=true;
- 				if (output)
+ 				if (DEBUG)
 					output->DrawYuvHorizontalLine(digits[d].x1, digits[d].x2, digits[d].y2, green); /* green line */
 			}
 		}
@@ -137,12 +333,14 @@ Ssocr& Ssocr::Recognize(const SsocrImg &input, SsocrImg *output, const char* dec
 		if (!find_dark) {
 			digits[d].y2=h-1;
 			find_dark=true;
-			if (output)
+			if (DEBUG)
 				output->DrawYuvHorizontalLine(digits[d].x1, digits[d].x2, digits[d].y2, green); /* green line */
 		}
 	}
+	SsocrTrace::Stop(trace, "vertical partition", stage_start);
 	
 	/* determine maximum digit dimensions */
+	stage_start=SsocrTrace::Start(trace);
 	for (int d=0; d<number_of_digits; d++) {
 		digits[d].w=digits[d].x2-digits[d].x1;
 		digits[d].h=digits[d].y2-digits[d].y1;
@@ -152,15 +350,26 @@ Ssocr& Ssocr::Recognize(const SsocrImg &input, SsocrImg *output, const char* dec
 		if (max_dig_h<digits[d].h)
 			max_dig_h=digits[d].h;
 
-		if (output) /* draw rectangles around digits */
+		if (DEBUG) /* draw rectangles around digits */
 			output->DrawYuvRectangle(digits[d].x1, digits[d].y1, digits[d].x2, digits[d].y2, gray); /* gray rectangle */
 	}
 
+	/* cells that were already decoded skip classification and segment scan */
+	bool matching=classifier==TEMPLATE_CLASSIFIER&&!templates.IsLearning();
+	if (glyphs.IsEnabled()||classifier==TEMPLATE_CLASSIFIER) {
+		glyph_keys.resize(number_of_digits);
+		for (int d=0; d<number_of_digits; d++)
+			if (digits[d].w&&digits[d].h) {
+				fingerprint(pixels, digits[d], max_dig_h, glyph_keys[d]);
+				digits[d].cached=glyphs.IsEnabled()&&glyphs.Lookup(glyph_keys[d], digits[d].digit);
+			}
+	}
+
 	/* at this point the digit 1, colon, decimal point (or thousands separator)
 	* and minus sign can be identified by relative size */
 	for (int d=0; d<number_of_digits; d++) {
 		/* skip digits with zero dimensions */
-		if (!digits[d].w||!digits[d].h)
+		if (!digits[d].w||!digits[d].h||digits[d].cached)
 			continue;
 
 		/* if width of digit is less than ONE_RATIO of its height it is a 1
@@ -192,26 +401,32 @@ Ssocr& Ssocr::Recognize(const SsocrImg &input, SsocrImg *output, const char* dec
 		}
  	}
 
+	SsocrTrace::Stop(trace, "classify by size", stage_start);
+
 	/* now the digits are located and they have to be identified */
+	stage_start=SsocrTrace::Start(trace);
 	/* iterate over digits */
 	for (int d=0; d<number_of_digits; d++) {
 		int middle=0, quarter=0, three_quarters=0; /* scanlines */
 		/* if digits[d].digit == D_ONE/D_DECIMAL/D_MINUS/D_COLON do nothing */
-		if (digits[d].digit==D_UNKNOWN) {
+		if (digits[d].digit==D_UNKNOWN&&!digits[d].cached&&matching&&digits[d].w&&digits[d].h) {
+			digits[d].digit=templates.Classify(glyph_keys[d].bits);
+		} else if (digits[d].digit==D_UNKNOWN&&!digits[d].cached) {
 			int third=1; /* in which third we are */
 			int half;
 			/* check horizontal segments */
 			/* vertical scan at x == middle */
 			middle=(digits[d].x1+digits[d].x2)/2;
 			for (int j=digits[d].y1; j<=digits[d].y2; j++) {
-				if (input.is_pixel_set(middle, j, abs_thresh, black_on_white)) { /* dark i.e. pixel is set */
-					if (output)
+				if (pixels.Get(middle, j)) { /* dark i.e. pixel is set */
+					if (DEBUG) {
 						if (third==1)
 							output->SetYuvPixel(middle, j, red);
 						else if (third==2)
 							output->SetYuvPixel(middle, j, green);
 						else if (third==3)
 							output->SetYuvPixel(middle, j, blue);
+					}
 					found_pixels++;
 				}
 				/* pixels in first third count towards upper segment */
@@ -236,12 +451,13 @@ Ssocr& Ssocr::Recognize(const SsocrImg &input, SsocrImg *output, const char* dec
 			half=1; /* in which half we are */
 			quarter=digits[d].y1+digits[d].h/4;
 			for (int i=digits[d].x1; i<=digits[d].x2; i++) {
-				if (input.is_pixel_set(i, quarter, abs_thresh, black_on_white)) { /* dark i.e. pixel is set */
-					if (output)
+				if (pixels.Get(i, quarter)) { /* dark i.e. pixel is set */
+					if (DEBUG) {
 						if (half==1)
 							output->SetYuvPixel(i, quarter, red);
 						else if (half==2)
 							output->SetYuvPixel(i, quarter, green);
+					}
 					found_pixels++;
 				}
 				if (i>=middle&&half==1) {
@@ -258,12 +474,13 @@ Ssocr& Ssocr::Recognize(const SsocrImg &input, SsocrImg *output, const char* dec
 			half=1; /* in which half we are */
 			three_quarters=digits[d].y1+3*digits[d].h/4;
 			for (int i=digits[d].x1; i<=digits[d].x2; i++) {
-				if (input.is_pixel_set(i, three_quarters, abs_thresh, black_on_white)) { /* dark i.e. pixel is set */
-					if (output)
+				if (pixels.Get(i, three_quarters)) { /* dark i.e. pixel is set */
+					if (DEBUG) {
 						if (half==1)
 							output->SetYuvPixel(i, three_quarters, red);
 						else if (half==2)
 							output->SetYuvPixel(i, three_quarters, green);
+					}
 					found_pixels++;
 				}
 				if (i>=middle&&half==1) {
@@ -278,7 +495,58 @@ Ssocr& Ssocr::Recognize(const SsocrImg &input, SsocrImg *output, const char* dec
 			found_pixels = 0;
 		}
 	}
+	if (glyphs.IsEnabled())
+		for (int d=0; d<number_of_digits; d++)
+			if (digits[d].w&&digits[d].h&&!digits[d].cached)
+				glyphs.Insert(glyph_keys[d], digits[d].digit);
+	if (classifier==TEMPLATE_CLASSIFIER&&templates.IsLearning()) {
+		for (int d=0; d<number_of_digits; d++)
+			if (digits[d].w&&digits[d].h&&!digits[d].cached)
+				templates.Learn(glyph_keys[d].bits, digits[d].digit);
+		templates.EndFrame();
+	}
+	SsocrTrace::Stop(trace, "scan segments", stage_start);
+}
 
+Ssocr& Ssocr::Recognize(const SsocrImg &source, SsocrImg *output, const char* dec_sep, const char* neg_sign, const SsocrMask *binarized)
+{
+	SsocrImg input(source); /* shallow copy of source that can be switched to binarized mask */
+	int w, h; /* width, height */
+	double abs_thresh; /* absolute threshold */
+	SsocrTicks stage_start; /* start of traced stage */
+
+	std::vector<digit_struct> digits; /* position of digits in image */
+	recognized_digits.clear();
+	input.set_pool(pool);
+
+	if (binarized) {
+		/* threshold is not used by is_pixel_set when mask is set */
+		input.set_mask(binarized);
+		abs_thresh=thresh;
+	} else {
+		abs_thresh=threshold_image(input, mask);
+	}
+
+	/* get image parameters */
+	w=input.GetWidth();
+	h=input.GetHeight();
+	if (output&&(output->GetHeight()!=h||output->GetWidth()!=w))
+		return *this;
+
+	/* kernel is specialized for the pixel source, so inner loops don't check threshold mode and polarity for every pixel */
+	if (input.get_mask())
+		find_digits(MaskPixels(*input.get_mask()), w, h, output, digits);
+	else if (input.GetBitDepth()>8&&black_on_white)
+		find_digits(LumaPixels<unsigned short, true>(input, abs_thresh), w, h, output, digits);
+	else if (input.GetBitDepth()>8)
+		find_digits(LumaPixels<unsigned short, false>(input, abs_thresh), w, h, output, digits);
+	else if (black_on_white)
+		find_digits(LumaPixels<unsigned char, true>(input, abs_thresh), w, h, output, digits);
+	else
+		find_digits(LumaPixels<unsigned char, false>(input, abs_thresh), w, h, output, digits);
+
+	/* decode segments */
+	stage_start=SsocrTrace::Start(trace);
 	for (std::vector<digit_struct>::iterator it=digits.begin(); it!=digits.end(); it++)
 		switch(it->digit) {
 			case D_ZERO: 
@@ -349,11 +617,166 @@ Ssocr& Ssocr::Recognize(const SsocrImg &input, SsocrImg *output, const char* dec
 				recognized_digits.push_back('?'); 
 				break;
 		}
+	SsocrTrace::Stop(trace, "decode segments", stage_start);
 
 	return *this;
 }
 
+/* lighting of fixed display changes over seconds, not frames: instead of full frame scan
+* luminance range is sampled sparsely and smoothed, sampling bias is corrected by the
+* difference measured at the last full scan, that is repeated if sampled range drifts */
+double Ssocr::temporal_threshold(const SsocrImg &input)
+{
+	double sub_min, sub_max; /* sampled range of current frame */
+	double drift=TEMPORAL_DRIFT*input.GetMaxLuma()/(double)MAXRGB; /* drift is given for 8-bit luminance */
+
+	input.get_range(TEMPORAL_STEP, 0, 0, -1, -1, sub_min, sub_max);
+
+	if (!temporal.valid||temporal.w!=input.GetWidth()||temporal.h!=input.GetHeight()||
+		fabs(sub_min-temporal.ref_min)>drift||fabs(sub_max-temporal.ref_max)>drift) {
+		input.get_range(1, 0, 0, -1, -1, temporal.min, temporal.max);
+		temporal.valid=true;
+		temporal.w=input.GetWidth();
+		temporal.h=input.GetHeight();
+		temporal.ref_min=sub_min;
+		temporal.ref_max=sub_max;
+		temporal.off_min=temporal.min-sub_min;
+		temporal.off_max=temporal.max-sub_max;
+	} else {
+		temporal.min+=TEMPORAL_ALPHA*(sub_min+temporal.off_min-temporal.min);
+		temporal.max+=TEMPORAL_ALPHA*(sub_max+temporal.off_max-temporal.max);
+	}
+
+	return (temporal.min+thresh/100.0*(temporal.max-temporal.min))*100/input.GetMaxLuma();
+}
+
 std::string Ssocr::GetLastRecognizedDigits()
 {
 	return recognized_digits;
+}
+
+void Ssocr::SetLastRecognizedDigits(const std::string &digits)
+{
+	recognized_digits=digits;
+}
+
+void Ssocr::SetGlyphCache(size_t entries)
+{
+	glyphs.SetCapacity(entries);
+}
+
+void Ssocr::SetClassifier(SsocrClassifier classifier, int learn_frames)
+{
+	this->classifier=classifier;
+	templates.SetLearning(learn_frames);
+	/* cached results of the other classifier would be mixed in */
+	glyphs.Clear();
+}
+
+const SsocrGlyphCache &Ssocr::GetGlyphCache() const
+{
+	return glyphs;
+}
+
+void Ssocr::SetDegradation(SsocrDegradation level)
+{
+	degradation=level;
+}
+
+SsocrDegradation Ssocr::GetDegradation() const
+{
+	return degradation;
+}
+
+std::string Ssocr::GetState() const
+{
+	std::ostringstream state;
+	state<<std::setprecision(17)<<temporal.valid<<' '<<temporal.w<<' '<<temporal.h<<' '<<temporal.min<<' '<<temporal.max<<' '
+		<<temporal.ref_min<<' '<<temporal.ref_max<<' '<<temporal.off_min<<' '<<temporal.off_max<<' '<<templates.GetState();
+	return state.str();
+}
+
+bool Ssocr::SetState(const std::string &state)
+{
+	std::istringstream iss(state);
+	temporal_state loaded;
+	std::string learned;
+	if (!(iss>>loaded.valid>>loaded.w>>loaded.h>>loaded.min>>loaded.max>>loaded.ref_min>>loaded.ref_max>>loaded.off_min>>loaded.off_max)||
+		!std::getline(iss, learned)||!templates.SetState(learned))
+		return false;
+	temporal=loaded;
+	return true;
+}
+
+void Ssocr::SetTrace(SsocrTrace *trace)
+{
+	this->trace=trace;
+}
+
+void Ssocr::SetStripPool(SsocrStripPool *pool)
+{
+	this->pool=pool;
+}
+
+bool Ssocr::SetCleanup(const std::string &ops)
+{
+	if (!SsocrMask::CheckOps(ops))
+		return false;
+	cleanup=ops;
+	return true;
+}
+
+bool Ssocr::ParseThreshold(std::string threshold, double &thresh, SsocrThreshold &thresh_flags)
+{
+	if (!threshold.length())
+		return false;
+
+	if (std::isalpha(threshold[threshold.length()-1])) {
+		switch (threshold[threshold.length()-1]) {
+			case 'i':
+				thresh_flags=ITERATIVE_THRESHOLD;
+				break;
+			case 'a':
+				thresh_flags=ABSOLUTE_THRESHOLD;
+				break;
+			case 's':
+				thresh_flags=TEMPORAL_THRESHOLD;
+				break;
+			case 'l':
+				thresh_flags=SAUVOLA_THRESHOLD;
+				break;
+			case 'n':
+				thresh_flags=NIBLACK_THRESHOLD;
+				break;
+			default:
+				return false;
+				break;
+		}
+		threshold.resize(threshold.length()-1);
+	} else {
+		thresh_flags=ADAPTIVE_THRESHOLD;
+	}
+	std::istringstream iss(threshold);
+	iss>>std::noskipws>>thresh;
+	if (!iss.eof()||iss.fail())
+		return false;
+	else
+		return true;
+}
+
+bool Ssocr::ParseClassifier(const std::string &str, SsocrClassifier &classifier, int &learn_frames)
+{
+	learn_frames=0;
+	if (str=="scanline") {
+		classifier=SCANLINE_CLASSIFIER;
+		return true;
+	}
+	if (str.compare(0, 8, "template"))
+		return false;
+	classifier=TEMPLATE_CLASSIFIER;
+	if (str.length()==8)
+		return true;
+	std::istringstream iss(str.substr(8));
+	iss>>std::noskipws>>learn_frames;
+	return iss.eof()&&!iss.fail()&&learn_frames>=0;
 }
\ No newline at end of file
@@ -20,11 +20,16 @@
 #include <vector>
 #include "ssocr_defines.h"
 #include "ssocr_imgproc.h"
+#include "ssocr_glyphcache.h"
+#include "ssocr_templates.h"
+#include "ssocr_strips.h"
+#include "ssocr_trace.h"
 
 class Ssocr {
 private: 
 	struct digit_struct {
 		int x1, y1, x2, y2, w, h, digit;
+		bool cached; /* digit was taken from glyph cache */
 	};
 
 	static const unsigned char red[3];
@@ -36,10 +41,73 @@ private:
 	SsocrThreshold thresh_flags; /* see ssocr_defines.h file */
 	bool black_on_white;
 	std::string recognized_digits;
+	SsocrTrace *trace; /* NULL if tracing is disabled */
+	SsocrStripPool *pool; /* NULL if frame is processed by calling thread only */
+	SsocrMask mask; /* binarized image for local threshold or cleanup, reused between frames */
+	SsocrMask mask_scratch; /* intermediate buffer of morphological operations */
+	std::string cleanup; /* morphological operations applied to mask, see SsocrMask::Apply */
+	std::vector<int> column_pixels; /* number of set pixels in every column, reused between frames */
+	std::vector<int> strip_pixels; /* column counts of every strip or row counts of every digit, reused between frames */
+	std::vector<int> digit_x1, digit_x2; /* column spans of digits for row counts */
+	SsocrGlyphCache glyphs; /* decoded digit cells, disabled by default */
+	std::vector<SsocrGlyphCache::Key> glyph_keys; /* fingerprints of digits of the current frame, reused between frames */
+	SsocrClassifier classifier; /* how cells that aren't classified by size are decoded */
+	SsocrTemplates templates;
+	SsocrDegradation degradation; /* accuracy traded for time, see SsocrDeadline */
+
+	/* temporal threshold state */
+	struct temporal_state {
+		bool valid; /* false until first full frame scan */
+		int w, h; /* size of image state is computed for */
+		double min, max; /* smoothed luminance range */
+		double ref_min, ref_max; /* sampled range at the last full frame scan */
+		double off_min, off_max; /* difference between full and sampled range at the last full frame scan */
+	} temporal;
+
+	/* compute threshold from sampled luminance range smoothed across frames */
+	double temporal_threshold(const SsocrImg &input);
+	/* adapt threshold to image, switch input to target mask if it was binarized */
+	double threshold_image(SsocrImg &input, SsocrMask &target);
+	/* find digits and their segments, kernel is instantiated for every pixel source and debug output on and off */
+	template <class Pixels>
+	void find_digits(const Pixels &pixels, int w, int h, SsocrImg *output, std::vector<digit_struct> &digits);
+	template <class Pixels, bool DEBUG>
+	void find_digits_kernel(const Pixels &pixels, int w, int h, SsocrImg *output, std::vector<digit_struct> &digits);
+	/* sample digit cell on glyph grid */
+	template <class Pixels>
+	static void fingerprint(const Pixels &pixels, const digit_struct &digit, int max_dig_h, SsocrGlyphCache::Key &key);
 public:
 	Ssocr(bool black_on_white, double thresh, SsocrThreshold thresh_flags);
-	Ssocr& Recognize(const SsocrImg &input, SsocrImg *output, const char* dec_sep, const char* neg_sign);
+	/* binarized mask (e.g. made earlier by Binarize) is used instead of thresholding input if given */
+	Ssocr& Recognize(const SsocrImg &input, SsocrImg *output, const char* dec_sep, const char* neg_sign, const SsocrMask *binarized=NULL);
+	/* binarize input with current threshold and cleanup settings, returns absolute threshold */
+	double Binarize(const SsocrImg &input, SsocrMask &binarized);
 	std::string GetLastRecognizedDigits();
+	/* result of recognition that was skipped (e.g. taken from cache) */
+	void SetLastRecognizedDigits(const std::string &digits);
+	/* state carried between frames (temporal threshold and template learning) as text, so long run can be resumed with it,
+	* it's set after SetClassifier that resets the templates */
+	std::string GetState() const;
+	/* returns false if state is malformed */
+	bool SetState(const std::string &state);
+	void SetTrace(SsocrTrace *trace);
+	/* threshold statistics, binarization and projection profiles are split in strips processed by the pool, segments are decoded serially */
+	void SetStripPool(SsocrStripPool *pool);
+	/* returns false if ops contain unknown operation */
+	bool SetCleanup(const std::string &ops);
+	/* cache of up to entries decoded digit cells, 0 disables it; cached cell is decoded by its fingerprint,
+	* so it may differ from full segment scan if cells with the same fingerprint differ on scanlines */
+	void SetGlyphCache(size_t entries);
+	/* template classifier starts with learn_frames frames decoded by scanlines and learns templates from them */
+	void SetClassifier(SsocrClassifier classifier, int learn_frames=0);
+	const SsocrGlyphCache &GetGlyphCache() const;
+	/* FAST_THRESHOLD and higher levels compute adaptive and iterative thresholds from sampled luminance range,
+	* SUBSAMPLED_ROWS and higher count every DEADLINE_ROW_STEP-th row in column profile */
+	void SetDegradation(SsocrDegradation level);
+	SsocrDegradation GetDegradation() const;
+	static bool ParseThreshold(std::string threshold, double &thresh, SsocrThreshold &thresh_flags);
+	/* "scanline", "template" or "template" followed by number of frames to learn from (e.g. "template25") */
+	static bool ParseClassifier(const std::string &str, SsocrClassifier &classifier, int &learn_frames);
 };
 
 #endif //SSOCR_H
\ No newline at end of file
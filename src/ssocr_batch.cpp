@@ -0,0 +1,520 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//ssocr-batch: standalone command line recognizer for YUV4MPEG2 and raw planar YUV files
+//Every input file gets it's own log in the same CSV format SegmentDisplayOCR filter produces
+//Raw video can also be streamed through stdin or FIFO and is recognized as it arrives
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+#include <getopt.h>
+#include "yuvfile.h"
+#include "yuvstream.h"
+#include "wspool.h"
+#include "ssocr.h"
+#include "ssocr_timer.h"
+#include "ssocr_imgproc.h"
+#include "ssocr_pipeline.h"
+#include "ssocr_defines.h"
+
+#define BATCH_CHUNK_FRAMES 250
+
+enum TFEnum {TMS, RTM, SEC, MSEC, FRAME};
+
+struct BatchOptions {
+	int interval;
+	TFEnum time_format;
+	bool inverted;
+	double thresh;
+	SsocrThreshold thresh_flags;
+	std::string cleanup;
+	SsocrClassifier classifier;
+	int learn_frames;
+	bool log_append;
+	int threads;
+	bool pipeline;
+	int depth;
+	bool drop;
+	int chunk_frames;
+	int first_frame;
+	int last_frame;				//Inclusive, -1 means last frame of the file
+	const char *output_dir;
+	YuvFile::Format raw_format;
+};
+
+//Per-input state: chunks can finish in any order but are written to the log in frame order
+class BatchFile {
+private:
+	pthread_mutex_t lock;
+	int next_chunk;
+	std::map<int, std::string> done_chunks;
+public:
+	std::string path;
+	YuvFile input;
+	std::ofstream log_file;
+
+	BatchFile(const std::string &path): next_chunk(0), done_chunks(), path(path), input(), log_file() { pthread_mutex_init(&lock, NULL); }
+	~BatchFile() { pthread_mutex_destroy(&lock); }
+	void Commit(int chunk, const std::string &log);
+};
+
+class ChunkTask: public WsTask {
+private:
+	const BatchOptions &options;
+	BatchFile &file;
+	int chunk;
+	int first_frame;
+	int last_frame;
+public:
+	ChunkTask(const BatchOptions &options, BatchFile &file, int chunk, int first_frame, int last_frame):
+		options(options), file(file), chunk(chunk), first_frame(first_frame), last_frame(last_frame) {}
+	void Run(int worker);
+};
+
+void BatchFile::Commit(int chunk, const std::string &log)
+{
+	pthread_mutex_lock(&lock);
+	done_chunks[chunk]=log;
+	for (std::map<int, std::string>::iterator it=done_chunks.begin(); it!=done_chunks.end()&&it->first==next_chunk; next_chunk++) {
+		log_file<<it->second;
+		done_chunks.erase(it++);
+	}
+	log_file.flush();
+	pthread_mutex_unlock(&lock);
+}
+
+static void WriteLogRecord(std::ostream &log, TFEnum time_format, int cur_frame, unsigned int cur_mseconds, const std::string &digits)
+{
+	char rtm_buf[80];
+	struct tm rtm_tm;
+	time_t rtm;
+
+	switch (time_format) {
+		case TMS:
+			log<<'"'<<SsocrTimer::GetTimestamp(cur_mseconds)<<'"';
+			break;
+		case RTM:
+			rtm=time(NULL);
+			strftime(rtm_buf, sizeof(rtm_buf), "%Y-%m-%d %H:%M:%S", localtime_r(&rtm, &rtm_tm));
+			log<<'"'<<rtm_buf<<'"';
+			break;
+		case SEC:
+			log<<cur_mseconds/1000;
+			break;
+		case MSEC:
+			log<<cur_mseconds;
+			break;
+		case FRAME:
+			log<<cur_frame;
+			break;
+	}
+	log<<','<<'"'<<digits<<'"'<<std::endl;
+}
+
+void ChunkTask::Run(int worker)
+{
+	const YuvFile::Format &format=file.input.GetFormat();
+	SsocrTimer timer(format.fps_numerator, format.fps_denominator, options.interval);
+	Ssocr ssocr(!options.inverted, options.thresh, options.thresh_flags);
+	ssocr.SetCleanup(options.cleanup);
+	ssocr.SetClassifier(options.classifier, options.learn_frames);
+	YuvImg::PlaneData planes[3];
+	std::ostringstream log;
+
+	//Only sampled frames are touched - the rest of the file is never paged in
+	for (int n=timer.GetNextAlarm(first_frame); n<last_frame; n=timer.GetNextAlarm(n+1)) {
+		if (!file.input.GetFrame(n, planes))
+			break;
+		if (options.interval)
+			file.input.AdviseFrame(timer.GetNextAlarm(n+1));
+		ssocr.Recognize(SsocrImg(planes, format.width, format.height, true), NULL, ".", "-");
+		WriteLogRecord(log, options.time_format, n, timer.GetMseconds(n), ssocr.GetLastRecognizedDigits());
+	}
+
+	file.Commit(chunk, log.str());
+}
+
+//Pipeline mode: sampled frames of single file are read in order and recognized in parallel
+class FileSource: public PipelineSource {
+private:
+	const YuvFile &input;
+	const SsocrTimer &timer;
+	int next_frame;
+	int end_frame;
+public:
+	FileSource(const YuvFile &input, const SsocrTimer &timer, int first_frame, int end_frame):
+		input(input), timer(timer), next_frame(timer.GetNextAlarm(first_frame)), end_frame(end_frame) {}
+	bool Read(int slot, PipelineFrame &frame);
+};
+
+class LogSink: public PipelineSink {
+private:
+	std::ostream &log;
+	const SsocrTimer &timer;
+	TFEnum time_format;
+public:
+	LogSink(std::ostream &log, const SsocrTimer &timer, TFEnum time_format): log(log), timer(timer), time_format(time_format) {}
+	void Write(const PipelineFrame &frame);
+};
+
+bool FileSource::Read(int slot, PipelineFrame &frame)
+{
+	if (next_frame>=end_frame||!input.GetFrame(next_frame, frame.planes))
+		return false;
+	frame.frame=next_frame;
+	frame.width=input.GetFormat().width;
+	frame.height=input.GetFormat().height;
+	next_frame=timer.GetNextAlarm(next_frame+1);
+	input.AdviseFrame(next_frame);
+	return true;
+}
+
+void LogSink::Write(const PipelineFrame &frame)
+{
+	WriteLogRecord(log, time_format, frame.frame, timer.GetMseconds(frame.frame), frame.digits);
+}
+
+static void PrintPipelineStats(const std::string &path, const SsocrPipeline::Stats &stats, int threads)
+{
+	//Stage throughput is frames per second of time the stage was actually busy
+	//Stage with the lowest throughput (for recognizer - multiplied by number of threads) is the bottleneck
+	fprintf(stderr, "%s: %d frames in %.2f s (%.1f fps)\n", path.c_str(), stats.frames, stats.wall_time, stats.wall_time>0?stats.frames/stats.wall_time:0.0);
+	fprintf(stderr, "  read:      %8.1f fps, stalled on full pipeline %.2f s\n", stats.read_time>0?stats.frames/stats.read_time:0.0, stats.read_stall);
+	fprintf(stderr, "  recognize: %8.1f fps per thread, %d threads\n", stats.recognize_time>0?stats.frames/stats.recognize_time:0.0, threads);
+	fprintf(stderr, "  write:     %8.1f fps, stalled on recognition %.2f s\n", stats.write_time>0?stats.frames/stats.write_time:0.0, stats.write_stall);
+}
+
+static void PrintStreamStats(const std::string &path, const YuvStream::Stats &stats)
+{
+	fprintf(stderr, "%s: %d frames read, %d queued for recognition, %d dropped\n", path.c_str(), stats.frames_read, stats.frames_queued, stats.frames_dropped);
+}
+
+static void Usage()
+{
+	fprintf(stderr,
+		"Usage: ssocr-batch [options] file...\n"
+		"Recognizes seven-segment display readings in YUV4MPEG2 (.y4m) or raw planar YUV files.\n"
+		"Raw video can also be read from stdin (\"-\") or FIFO.\n"
+		"\n"
+		"  -i, --interval=N       recognition interval in seconds, 0 - every frame (default: %d)\n"
+		"  -t, --threshold=STR    threshold in percents with optional \"a\", \"i\", \"s\", \"l\" or \"n\"\n"
+		"                         modificator (default: \"%s\")\n"
+		"  -n, --inverted         white digits on black background\n"
+		"  -m, --cleanup=OPS      morphological cleanup of binarized frame: sequence of \"e\" (erode),\n"
+		"                         \"d\" (dilate), \"o\" (open) and \"c\" (close) operations\n"
+		"  -C, --classifier=STR   scanline, template or templateN - templates learned from first N frames\n"
+		"                         of every chunk (every thread in pipeline mode) (default: \"%s\")\n"
+		"  -f, --time_format=STR  seconds, mseconds, timestamp, frame or realtime (default: \"%s\")\n"
+		"  -a, --append           append to existing logs instead of truncating them\n"
+		"  -o, --output_dir=DIR   directory for logs (default: next to input files)\n"
+		"  -j, --threads=N        number of worker threads (default: number of CPUs)\n"
+		"  -k, --chunk=N          number of frames in single work item (default: %d)\n"
+		"  -p, --pipeline         process files one by one, recognizing frames of each file in parallel\n"
+		"                         (reports throughput of pipeline stages)\n"
+		"  -d, --depth=N          maximum number of frames in flight in pipeline mode (default: 4 per thread)\n"
+		"                         or queued frames of raw video stream (default: %d)\n"
+		"  -D, --drop             drop the oldest queued frame of raw video stream when recognition falls\n"
+		"                         behind instead of blocking the writer\n"
+		"  -R, --range=F[:L]      process only frames F to L (inclusive) of every file\n"
+		"  -s, --size=WxH         frame size of raw video\n"
+		"  -r, --fps=N[/D]        frame rate of raw video (default: 25)\n"
+		"  -c, --chroma=STR       chroma subsampling of raw video: 420, 422, 444 or 411 (default: 420),\n"
+		"                         9 to 16-bit video has \"pN\" suffix, e.g. 420p10\n"
+		"\n"
+		"Log for input file \"name.ext\" is written to \"name.ext.csv\", log for stdin - to stdout.\n",
+		OCRF_INTERVAL, OCRF_THRESHOLD, OCRF_CLASSIFIER, OCRF_TIME_FORMAT, BATCH_CHUNK_FRAMES, STREAM_DEPTH);
+}
+
+static bool ParseTimeFormat(const char *time_format, TFEnum &tf)
+{
+	if (!strcmp("seconds", time_format)) {
+		tf=SEC;
+	} else if (!strcmp("mseconds", time_format)) {
+		tf=MSEC;
+	} else if (!strcmp("timestamp", time_format)) {
+		tf=TMS;
+	} else if (!strcmp("frame", time_format)) {
+		tf=FRAME;
+	} else if (!strcmp("realtime", time_format)) {
+		tf=RTM;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+static std::string GetLogPath(const char *output_dir, const std::string &input_path)
+{
+	if (!output_dir)
+		return input_path+".csv";
+	std::string::size_type slash=input_path.rfind('/');
+	return std::string(output_dir)+"/"+(slash==std::string::npos?input_path:input_path.substr(slash+1))+".csv";
+}
+
+static int GetEndFrame(const BatchOptions &options, const YuvFile &input)
+{
+	if (options.last_frame>=0&&options.last_frame<input.GetFrameCount())
+		return options.last_frame+1;
+	else
+		return input.GetFrameCount();
+}
+
+//Single recognizer thread, so temporal state and learned templates follow the whole stream
+static bool RunStream(const BatchOptions &options, const char *path)
+{
+	YuvStream stream(options.raw_format, options.interval, options.first_frame, options.last_frame, options.depth, options.drop);
+	std::string error;
+	if (!stream.Open(path, error)) {
+		fprintf(stderr, "ssocr-batch: %s: %s!\n", path, error.c_str());
+		return false;
+	}
+
+	//Log of stdin goes to stdout
+	std::ofstream log_file;
+	if (strcmp(path, "-")) {
+		std::string log_path=GetLogPath(options.output_dir, path);
+		log_file.open(log_path.c_str(), options.log_append?std::ios::app:std::ios::trunc);
+		if (!log_file.is_open()) {
+			fprintf(stderr, "ssocr-batch: error while opening file \"%s\"!\n", log_path.c_str());
+			return false;
+		}
+	}
+	std::ostream &log=log_file.is_open()?(std::ostream&)log_file:std::cout;
+
+	const YuvFile::Format &format=stream.GetFormat();
+	Ssocr ssocr(!options.inverted, options.thresh, options.thresh_flags);
+	ssocr.SetCleanup(options.cleanup);
+	ssocr.SetClassifier(options.classifier, options.learn_frames);
+	YuvImg::PlaneData planes[3];
+	int n;
+
+	while (stream.GetFrame(n, planes)) {
+		ssocr.Recognize(SsocrImg(planes, format.width, format.height, true), NULL, ".", "-");
+		WriteLogRecord(log, options.time_format, n, stream.GetTimer().GetMseconds(n), ssocr.GetLastRecognizedDigits());
+	}
+
+	PrintStreamStats(path, stream.GetStats());
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option long_options[]={
+		{"interval", required_argument, NULL, 'i'},
+		{"threshold", required_argument, NULL, 't'},
+		{"inverted", no_argument, NULL, 'n'},
+		{"cleanup", required_argument, NULL, 'm'},
+		{"classifier", required_argument, NULL, 'C'},
+		{"time_format", required_argument, NULL, 'f'},
+		{"append", no_argument, NULL, 'a'},
+		{"output_dir", required_argument, NULL, 'o'},
+		{"threads", required_argument, NULL, 'j'},
+		{"chunk", required_argument, NULL, 'k'},
+		{"range", required_argument, NULL, 'R'},
+		{"pipeline", no_argument, NULL, 'p'},
+		{"depth", required_argument, NULL, 'd'},
+		{"drop", no_argument, NULL, 'D'},
+		{"size", required_argument, NULL, 's'},
+		{"fps", required_argument, NULL, 'r'},
+		{"chroma", required_argument, NULL, 'c'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0}
+	};
+	BatchOptions options;
+	int opt;
+
+	options.interval=OCRF_INTERVAL;
+	options.time_format=SEC;
+	options.inverted=OCRF_INVERTED;
+	Ssocr::ParseThreshold(OCRF_THRESHOLD, options.thresh, options.thresh_flags);
+	Ssocr::ParseClassifier(OCRF_CLASSIFIER, options.classifier, options.learn_frames);
+	options.log_append=false;
+	options.threads=WsPool::GetCpuCount();
+	options.pipeline=false;
+	options.depth=0;
+	options.drop=false;
+	options.chunk_frames=BATCH_CHUNK_FRAMES;
+	options.first_frame=0;
+	options.last_frame=-1;
+	options.output_dir=NULL;
+	options.raw_format.width=options.raw_format.height=0;
+	options.raw_format.fps_numerator=25;
+	options.raw_format.fps_denominator=1;
+	options.raw_format.width_sub=options.raw_format.height_sub=1;
+	options.raw_format.bit_depth=8;
+
+	while ((opt=getopt_long(argc, argv, "i:t:nm:C:f:ao:j:k:R:pd:Ds:r:c:h", long_options, NULL))!=-1) {
+		switch (opt) {
+			case 'i':
+				options.interval=atoi(optarg);
+				if (options.interval<0) {
+					fprintf(stderr, "ssocr-batch: interval can't be negative number!\n");
+					return 1;
+				}
+				break;
+			case 't':
+				if (!Ssocr::ParseThreshold(optarg, options.thresh, options.thresh_flags)) {
+					fprintf(stderr, "ssocr-batch: unrecognized threshold string \"%s\"!\n", optarg);
+					return 1;
+				}
+				if (options.thresh<0.0||options.thresh>100.0) {
+					fprintf(stderr, "ssocr-batch: threshold should be between 0 and 100!\n");
+					return 1;
+				}
+				break;
+			case 'n':
+				options.inverted=true;
+				break;
+			case 'm':
+				if (!SsocrMask::CheckOps(optarg)) {
+					fprintf(stderr, "ssocr-batch: unrecognized cleanup string \"%s\"!\n", optarg);
+					return 1;
+				}
+				options.cleanup=optarg;
+				break;
+			case 'C':
+				if (!Ssocr::ParseClassifier(optarg, options.classifier, options.learn_frames)) {
+					fprintf(stderr, "ssocr-batch: unrecognized classifier string \"%s\"!\n", optarg);
+					return 1;
+				}
+				break;
+			case 'f':
+				if (!ParseTimeFormat(optarg, options.time_format)) {
+					fprintf(stderr, "ssocr-batch: unknown time_format \"%s\"!\n", optarg);
+					return 1;
+				}
+				break;
+			case 'a':
+				options.log_append=true;
+				break;
+			case 'o':
+				options.output_dir=optarg;
+				break;
+			case 'j':
+				options.threads=atoi(optarg);
+				break;
+			case 'k':
+				options.chunk_frames=atoi(optarg);
+				break;
+			case 'p':
+				options.pipeline=true;
+				break;
+			case 'd':
+				options.depth=atoi(optarg);
+				break;
+			case 'D':
+				options.drop=true;
+				break;
+			case 'R':
+				if (sscanf(optarg, "%d:%d", &options.first_frame, &options.last_frame)<1||options.first_frame<0||(options.last_frame>=0&&options.last_frame<options.first_frame)) {
+					fprintf(stderr, "ssocr-batch: invalid frame range \"%s\"!\n", optarg);
+					return 1;
+				}
+				break;
+			case 's':
+				if (sscanf(optarg, "%dx%d", &options.raw_format.width, &options.raw_format.height)!=2) {
+					fprintf(stderr, "ssocr-batch: invalid frame size \"%s\"!\n", optarg);
+					return 1;
+				}
+				break;
+			case 'r':
+				if (sscanf(optarg, "%d/%d", &options.raw_format.fps_numerator, &options.raw_format.fps_denominator)<1) {
+					fprintf(stderr, "ssocr-batch: invalid frame rate \"%s\"!\n", optarg);
+					return 1;
+				}
+				break;
+			case 'c':
+				if (!YuvFile::ParseChroma(optarg, options.raw_format.width_sub, options.raw_format.height_sub, options.raw_format.bit_depth)) {
+					fprintf(stderr, "ssocr-batch: unsupported chroma subsampling \"%s\"!\n", optarg);
+					return 1;
+				}
+				break;
+			default:
+				Usage();
+				return opt=='h'?0:1;
+		}
+	}
+
+	if (optind>=argc||options.threads<=0||options.chunk_frames<=0) {
+		Usage();
+		return 1;
+	}
+
+	std::vector<BatchFile*> files;
+	std::vector<const char*> streams;
+	int result=0;
+
+	for (int i=optind; i<argc; i++) {
+		if (YuvStream::IsStream(argv[i])) {
+			streams.push_back(argv[i]);
+			continue;
+		}
+		BatchFile *file=new BatchFile(argv[i]);
+		std::string error;
+		if (!file->input.Open(argv[i], options.raw_format, error)) {
+			fprintf(stderr, "ssocr-batch: %s: %s!\n", argv[i], error.c_str());
+			delete file;
+			result=1;
+			continue;
+		}
+		std::string log_path=GetLogPath(options.output_dir, file->path);
+		file->log_file.open(log_path.c_str(), options.log_append?std::ios::app:std::ios::trunc);
+		if (!file->log_file.is_open()) {
+			fprintf(stderr, "ssocr-batch: error while opening file \"%s\"!\n", log_path.c_str());
+			delete file;
+			result=1;
+			continue;
+		}
+		files.push_back(file);
+	}
+
+	if (options.pipeline) {
+		for (std::vector<BatchFile*>::iterator it=files.begin(); it!=files.end(); it++) {
+			const YuvFile::Format &format=(*it)->input.GetFormat();
+			SsocrTimer timer(format.fps_numerator, format.fps_denominator, options.interval);
+			FileSource source((*it)->input, timer, options.first_frame, GetEndFrame(options, (*it)->input));
+			LogSink sink((*it)->log_file, timer, options.time_format);
+			Ssocr ssocr(!options.inverted, options.thresh, options.thresh_flags);
+			ssocr.SetCleanup(options.cleanup);
+			ssocr.SetClassifier(options.classifier, options.learn_frames);
+			SsocrPipeline pipeline(source, sink, ssocr, ".", "-", options.threads, options.depth>0?options.depth:4*options.threads);
+			PrintPipelineStats((*it)->path, pipeline.Run(), options.threads);
+		}
+	} else {
+		//Long files are split in chunks so single file can also be spread across all threads
+		WsPool pool(options.threads);
+		for (std::vector<BatchFile*>::iterator it=files.begin(); it!=files.end(); it++) {
+			int end_frame=GetEndFrame(options, (*it)->input);
+			for (int first=options.first_frame, chunk=0; first<end_frame; first+=options.chunk_frames, chunk++)
+				pool.Submit(new ChunkTask(options, **it, chunk, first, std::min(first+options.chunk_frames, end_frame)));
+		}
+		pool.Run();
+	}
+
+	for (std::vector<BatchFile*>::iterator it=files.begin(); it!=files.end(); it++)
+		delete *it;
+
+	for (std::vector<const char*>::iterator it=streams.begin(); it!=streams.end(); it++)
+		if (!RunStream(options, *it))
+			result=1;
+
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,420 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//ssocr-bench: microbenchmarks of recognition core on synthetic seven-segment frames
+//Every recognition benchmark also checks that recognized string matches rendered one
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <time.h>
+#include <getopt.h>
+#include "segrender.h"
+#include "ssocr.h"
+#include "ssocr_imgproc.h"
+#include "ssocr_defines.h"
+
+#define BENCH_MIN_TIME 0.2
+
+struct BenchOptions {
+	std::vector<SegRender::Params> sizes;
+	std::vector<std::string> texts;
+	SegRender::Params render;
+	std::string cleanup;
+	std::vector<int> threads;
+	int bit_depth;
+	int glyphs;
+	SsocrClassifier classifier;
+	int learn_frames;
+	double min_time;
+};
+
+class BenchCase {
+public:
+	virtual ~BenchCase() {}
+	virtual void Run(int iteration)=0;
+};
+
+//Rendered test frames of single resolution, copied to separate buffers so debug output can draw on them
+class BenchFrames {
+private:
+	std::vector<std::vector<unsigned char> > buffers;
+	std::vector<std::vector<YuvImg::PlaneData> > planes;
+public:
+	int width;
+	int height;
+
+	BenchFrames(const SegRender::Params &params, const std::vector<std::string> &texts, int bit_depth);
+	int GetCount() const { return planes.size(); }
+	const YuvImg::PlaneData *GetPlanes(int n) const { return &planes[n][0]; }
+};
+
+class RecognizeCase: public BenchCase {
+private:
+	const BenchFrames &frames;
+	BenchFrames *output;
+	Ssocr ssocr;
+public:
+	RecognizeCase(const BenchFrames &frames, BenchFrames *output, const Ssocr &ssocr): frames(frames), output(output), ssocr(ssocr) {}
+	void Run(int iteration);
+	std::string Recognize(int n);
+	const SsocrGlyphCache &GetGlyphCache() const { return ssocr.GetGlyphCache(); }
+};
+
+class ThresholdCase: public BenchCase {
+private:
+	const BenchFrames &frames;
+	double thresh;
+	SsocrThreshold thresh_flags;
+	bool black_on_white;
+	SsocrStripPool *pool;
+	SsocrMask mask;
+public:
+	ThresholdCase(const BenchFrames &frames, double thresh, SsocrThreshold thresh_flags, bool black_on_white, SsocrStripPool *pool): frames(frames), thresh(thresh), thresh_flags(thresh_flags), black_on_white(black_on_white), pool(pool), mask() {}
+	void Run(int iteration);
+};
+
+class DrawCase: public BenchCase {
+public:
+	enum DrawOp {MONOCHROME, RECTANGLE, HLINE, VLINE, PIXEL};
+private:
+	BenchFrames &frames;
+	DrawOp op;
+public:
+	DrawCase(BenchFrames &frames, DrawOp op): frames(frames), op(op) {}
+	void Run(int iteration);
+};
+
+static const unsigned char gray[3]={127, 128, 128};
+
+BenchFrames::BenchFrames(const SegRender::Params &params, const std::vector<std::string> &texts, int bit_depth):
+	buffers(texts.size()), planes(texts.size(), std::vector<YuvImg::PlaneData>(3)), width(params.width), height(params.height)
+{
+	SegRender render(params);
+	for (size_t t=0; t<texts.size(); t++) {
+		render.Render(texts[t]);
+		if (bit_depth<=8) {
+			buffers[t].resize(render.GetFrameSize());
+			render.CopyTo(&buffers[t][0], &planes[t][0]);
+			continue;
+		}
+		//Rendered 8-bit samples are scaled to the full range of the bit depth and stored in 16-bit words
+		buffers[t].resize(render.GetFrameSize()*2);
+		unsigned short *dst=(unsigned short*)&buffers[t][0];
+		for (int p=0; p<3; p++) {
+			const YuvImg::PlaneData &src=render.GetPlanes()[p];
+			planes[t][p]=src;
+			planes[t][p].ptr=(unsigned char*)dst;
+			planes[t][p].width=src.width*2;
+			planes[t][p].pitch=src.width*2;
+			planes[t][p].bit_depth=bit_depth;
+			for (int y=0; y<src.height; y++)
+				for (int x=0; x<src.width; x++)
+					*dst++=src.ptr[src.pitch*y+x]*((1<<bit_depth)-1)/MAXRGB;
+		}
+	}
+}
+
+std::string RecognizeCase::Recognize(int n)
+{
+	const YuvImg::PlaneData *src=frames.GetPlanes(n%frames.GetCount());
+	if (output) {
+		SsocrImg dst_img(output->GetPlanes(n%output->GetCount()), output->width, output->height, false);
+		dst_img.MakeMonochrome();
+		ssocr.Recognize(SsocrImg(src, frames.width, frames.height, true), &dst_img, ".", "-");
+	} else {
+		ssocr.Recognize(SsocrImg(src, frames.width, frames.height, true), NULL, ".", "-");
+	}
+	return ssocr.GetLastRecognizedDigits();
+}
+
+void RecognizeCase::Run(int iteration)
+{
+	Recognize(iteration);
+}
+
+void ThresholdCase::Run(int iteration)
+{
+	SsocrImg img(frames.GetPlanes(iteration%frames.GetCount()), frames.width, frames.height, true);
+	img.set_pool(pool);
+	if (thresh_flags==SAUVOLA_THRESHOLD||thresh_flags==NIBLACK_THRESHOLD)
+		img.local_threshold(mask, thresh, thresh_flags, black_on_white);
+	else
+		img.adapt_threshold(thresh, 0, 0, -1, -1, thresh_flags);
+}
+
+void DrawCase::Run(int iteration)
+{
+	SsocrImg img(frames.GetPlanes(iteration%frames.GetCount()), frames.width, frames.height, false);
+	switch (op) {
+		case MONOCHROME:
+			img.MakeMonochrome();
+			break;
+		case RECTANGLE:
+			img.DrawYuvRectangle(0, 0, frames.width-1, frames.height-1, gray);
+			break;
+		case HLINE:
+			img.DrawYuvHorizontalLine(0, frames.width-1, frames.height/2, gray);
+			break;
+		case VLINE:
+			img.DrawYuvVerticalLine(frames.width/2, 0, frames.height-1, gray);
+			break;
+		case PIXEL:
+			for (int x=0; x<frames.width; x++)
+				img.SetYuvPixel(x, frames.height/2, gray);
+			break;
+	}
+}
+
+static double GetTime()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec+ts.tv_nsec/1000000000.0;
+}
+
+//Runs the case in batches of doubling size until min_time is spent, returns ns per iteration
+static double Measure(BenchCase &bench, double min_time)
+{
+	int iterations=0;
+	double start=GetTime();
+	double elapsed=0.0;
+
+	for (int batch=1; elapsed<min_time; batch*=2) {
+		for (int i=0; i<batch; i++)
+			bench.Run(iterations++);
+		elapsed=GetTime()-start;
+	}
+
+	return elapsed*1000000000.0/iterations;
+}
+
+static void Usage()
+{
+	fprintf(stderr,
+		"Usage: ssocr-bench [options]\n"
+		"Benchmarks recognition core on synthetic seven-segment frames.\n"
+		"\n"
+		"  -s, --size=WxH      frame size, can be repeated (default: 320x240 to 3840x2160)\n"
+		"  -t, --text=STR      rendered string of 0-9, a-f, '.', '-' and ':', can be repeated\n"
+		"  -n, --inverted      white digits on black background\n"
+		"  -N, --noise=N       amplitude of luma noise (default: 0)\n"
+		"  -b, --blur=N        radius of box blur (default: 0)\n"
+		"  -k, --skew=N        horizontal shift of digits per line in pixels (default: 0)\n"
+		"  -m, --cleanup=OPS   morphological cleanup applied in recognition benchmarks\n"
+		"  -j, --threads=N     threads splitting single frame in strips, can be repeated (default: 1)\n"
+		"  -B, --bits=N        bit depth of frames, 8 to 16 (default: 8)\n"
+		"  -g, --glyphs=N      glyph cache entries in recognition benchmarks (default: 0)\n"
+		"  -C, --classifier=S  scanline, template or templateN (learned from first N frames) (default: %s)\n"
+		"  -T, --time=N        minimum time of single benchmark in seconds (default: %g)\n",
+		OCRF_CLASSIFIER, BENCH_MIN_TIME);
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option long_options[]={
+		{"size", required_argument, NULL, 's'},
+		{"text", required_argument, NULL, 't'},
+		{"inverted", no_argument, NULL, 'n'},
+		{"noise", required_argument, NULL, 'N'},
+		{"blur", required_argument, NULL, 'b'},
+		{"skew", required_argument, NULL, 'k'},
+		{"cleanup", required_argument, NULL, 'm'},
+		{"threads", required_argument, NULL, 'j'},
+		{"bits", required_argument, NULL, 'B'},
+		{"glyphs", required_argument, NULL, 'g'},
+		{"classifier", required_argument, NULL, 'C'},
+		{"time", required_argument, NULL, 'T'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0}
+	};
+	static const int default_sizes[][2]={{320, 240}, {640, 480}, {1280, 720}, {1920, 1080}, {3840, 2160}};
+	static const char *default_texts[]={"-12.34", "56:78", "90.abcdef"};
+	static const char *thresholds[]={"50a", "50", "50i", "50s", "50l", "20n"};
+	static const char *threshold_names[]={"absolute", "adaptive", "iterative", "temporal", "sauvola", "niblack"};
+	static const char *draw_names[]={"MakeMonochrome", "DrawYuvRectangle", "DrawYuvHorizontalLine", "DrawYuvVerticalLine", "SetYuvPixel (row)"};
+	BenchOptions options;
+	int opt;
+
+	options.render.width=options.render.height=0;
+	options.render.inverted=false;
+	options.render.noise=0;
+	options.render.blur=0;
+	options.render.skew=0.0;
+	options.render.seed=1;
+	options.bit_depth=8;
+	options.glyphs=0;
+	Ssocr::ParseClassifier(OCRF_CLASSIFIER, options.classifier, options.learn_frames);
+	options.min_time=BENCH_MIN_TIME;
+
+	while ((opt=getopt_long(argc, argv, "s:t:nN:b:k:m:j:B:g:C:T:h", long_options, NULL))!=-1) {
+		switch (opt) {
+			case 's':
+				if (sscanf(optarg, "%dx%d", &options.render.width, &options.render.height)!=2||options.render.width<=0||options.render.height<=0) {
+					fprintf(stderr, "ssocr-bench: invalid frame size \"%s\"!\n", optarg);
+					return 1;
+				}
+				options.sizes.push_back(options.render);
+				break;
+			case 't':
+				options.texts.push_back(optarg);
+				break;
+			case 'n':
+				options.render.inverted=true;
+				break;
+			case 'N':
+				options.render.noise=atoi(optarg);
+				break;
+			case 'b':
+				options.render.blur=atoi(optarg);
+				break;
+			case 'k':
+				options.render.skew=atof(optarg);
+				break;
+			case 'm':
+				if (!SsocrMask::CheckOps(optarg)) {
+					fprintf(stderr, "ssocr-bench: unrecognized cleanup string \"%s\"!\n", optarg);
+					return 1;
+				}
+				options.cleanup=optarg;
+				break;
+			case 'j':
+				if (atoi(optarg)<=0) {
+					fprintf(stderr, "ssocr-bench: invalid number of threads \"%s\"!\n", optarg);
+					return 1;
+				}
+				options.threads.push_back(atoi(optarg));
+				break;
+			case 'B':
+				options.bit_depth=atoi(optarg);
+				if (options.bit_depth<8||options.bit_depth>16) {
+					fprintf(stderr, "ssocr-bench: bit depth should be between 8 and 16!\n");
+					return 1;
+				}
+				break;
+			case 'g':
+				options.glyphs=atoi(optarg);
+				if (options.glyphs<0) {
+					fprintf(stderr, "ssocr-bench: invalid number of glyph cache entries \"%s\"!\n", optarg);
+					return 1;
+				}
+				break;
+			case 'C':
+				if (!Ssocr::ParseClassifier(optarg, options.classifier, options.learn_frames)) {
+					fprintf(stderr, "ssocr-bench: unrecognized classifier string \"%s\"!\n", optarg);
+					return 1;
+				}
+				break;
+			case 'T':
+				options.min_time=atof(optarg);
+				break;
+			default:
+				Usage();
+				return opt=='h'?0:1;
+		}
+	}
+
+	if (options.sizes.empty())
+		for (size_t s=0; s<sizeof(default_sizes)/sizeof(default_sizes[0]); s++) {
+			options.render.width=default_sizes[s][0];
+			options.render.height=default_sizes[s][1];
+			options.sizes.push_back(options.render);
+		}
+	if (options.threads.empty())
+		options.threads.push_back(1);
+	if (options.texts.empty())
+		options.texts.assign(default_texts, default_texts+sizeof(default_texts)/sizeof(default_texts[0]));
+	//Options given after -s still apply to every size
+	for (std::vector<SegRender::Params>::iterator it=options.sizes.begin(); it!=options.sizes.end(); it++) {
+		it->inverted=options.render.inverted;
+		it->noise=options.render.noise;
+		it->blur=options.render.blur;
+		it->skew=options.render.skew;
+	}
+	for (std::vector<std::string>::iterator it=options.texts.begin(); it!=options.texts.end(); it++)
+		if (!SegRender(options.sizes[0]).Render(*it)) {
+			fprintf(stderr, "ssocr-bench: unsupported characters in text \"%s\"!\n", it->c_str());
+			return 1;
+		}
+
+	int failed=0;
+	//Pools are started once, like in the filter, so benchmarks don't include thread creation
+	std::vector<SsocrStripPool*> pools;
+	for (std::vector<int>::iterator it=options.threads.begin(); it!=options.threads.end(); it++)
+		pools.push_back(*it>1?new SsocrStripPool(*it):NULL);
+
+	printf("%-10s %-22s %-6s %7s %12s %10s  %s\n", "size", "benchmark", "debug", "threads", "ns/frame", "Mpixel/s", "result");
+	for (std::vector<SegRender::Params>::iterator it=options.sizes.begin(); it!=options.sizes.end(); it++) {
+		BenchFrames frames(*it, options.texts, options.bit_depth);
+		BenchFrames output(*it, options.texts, options.bit_depth);
+		double mpixels=(double)it->width*it->height/1000000.0;
+		char size[32];
+		sprintf(size, "%dx%d", it->width, it->height);
+
+		for (size_t t=0; t<sizeof(thresholds)/sizeof(thresholds[0]); t++) {
+			double thresh, ns;
+			SsocrThreshold thresh_flags;
+			Ssocr::ParseThreshold(thresholds[t], thresh, thresh_flags);
+
+			for (size_t p=0; p<pools.size(); p++) {
+				//Temporal threshold depends on previous frames and is measured only as part of Recognize
+				if (thresh_flags!=TEMPORAL_THRESHOLD) {
+					ThresholdCase threshold_case(frames, thresh, thresh_flags, !it->inverted, pools[p]);
+					ns=Measure(threshold_case, options.min_time);
+					printf("%-10s %-22s %-6s %7d %12.0f %10.1f\n", size, (std::string(thresh_flags==SAUVOLA_THRESHOLD||thresh_flags==NIBLACK_THRESHOLD?"local_threshold ":"adapt_threshold ")+threshold_names[t]).c_str(), "", options.threads[p], ns, mpixels*1000000000.0/ns);
+				}
+
+				Ssocr ssocr(!it->inverted, thresh, thresh_flags);
+				ssocr.SetCleanup(options.cleanup);
+				ssocr.SetStripPool(pools[p]);
+				ssocr.SetGlyphCache(options.glyphs);
+				ssocr.SetClassifier(options.classifier, options.learn_frames);
+				for (int debug=0; debug<2; debug++) {
+					RecognizeCase recognize_case(frames, debug?&output:NULL, ssocr);
+					std::string result="ok";
+					for (size_t n=0; n<options.texts.size(); n++) {
+						std::string digits=recognize_case.Recognize(n);
+						if (digits!=options.texts[n]) {
+							result="FAIL: \""+digits+"\" instead of \""+options.texts[n]+"\"";
+							failed++;
+							break;
+						}
+					}
+					ns=Measure(recognize_case, options.min_time);
+					if (recognize_case.GetGlyphCache().GetLookups()) {
+						char hits[32];
+						sprintf(hits, ", %.1f%% glyph hits", 100.0*recognize_case.GetGlyphCache().GetHits()/recognize_case.GetGlyphCache().GetLookups());
+						result+=hits;
+					}
+					printf("%-10s %-22s %-6s %7d %12.0f %10.1f  %s\n", size, (std::string("Recognize ")+threshold_names[t]).c_str(), debug?"on":"off", options.threads[p], ns, mpixels*1000000000.0/ns, result.c_str());
+				}
+			}
+		}
+
+		for (int d=0; d<5; d++) {
+			DrawCase draw_case(output, (DrawCase::DrawOp)d);
+			double ns=Measure(draw_case, options.min_time);
+			printf("%-10s %-22s %-6s %7s %12.0f %10s\n", size, draw_names[d], "", "", ns, "");
+		}
+	}
+
+	for (std::vector<SsocrStripPool*>::iterator it=pools.begin(); it!=pools.end(); it++)
+		delete *it;
+
+	if (failed)
+		fprintf(stderr, "ssocr-bench: %d recognition benchmarks produced wrong result!\n", failed);
+
+	return failed?1:0;
+}
\ No newline at end of file
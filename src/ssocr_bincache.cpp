@@ -0,0 +1,168 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "ssocr_bincache.h"
+
+#ifdef _WIN32
+static void *CreateLock()
+{
+	CRITICAL_SECTION *cs=new CRITICAL_SECTION;
+	InitializeCriticalSection(cs);
+	return cs;
+}
+
+static void DestroyLock(void *lock)
+{
+	DeleteCriticalSection((CRITICAL_SECTION*)lock);
+	delete (CRITICAL_SECTION*)lock;
+}
+
+static void EnterLock(void *lock)
+{
+	EnterCriticalSection((CRITICAL_SECTION*)lock);
+}
+
+static void LeaveLock(void *lock)
+{
+	LeaveCriticalSection((CRITICAL_SECTION*)lock);
+}
+#else
+static void *CreateLock()
+{
+	pthread_mutex_t *mutex=new pthread_mutex_t;
+	pthread_mutex_init(mutex, NULL);
+	return mutex;
+}
+
+static void DestroyLock(void *lock)
+{
+	pthread_mutex_destroy((pthread_mutex_t*)lock);
+	delete (pthread_mutex_t*)lock;
+}
+
+static void EnterLock(void *lock)
+{
+	pthread_mutex_lock((pthread_mutex_t*)lock);
+}
+
+static void LeaveLock(void *lock)
+{
+	pthread_mutex_unlock((pthread_mutex_t*)lock);
+}
+#endif
+
+bool SsocrBinCache::Key::operator<(const Key &other) const
+{
+	if (source!=other.source) return source<other.source;
+	if (context!=other.context) return context<other.context;
+	if (frame!=other.frame) return frame<other.frame;
+	if (x!=other.x) return x<other.x;
+	if (y!=other.y) return y<other.y;
+	if (w!=other.w) return w<other.w;
+	if (h!=other.h) return h<other.h;
+	return config<other.config;
+}
+
+SsocrBinCache::SsocrBinCache(size_t budget):
+	entries(), index(), bytes(0), budget(budget), lock(CreateLock())
+{
+}
+
+SsocrBinCache::~SsocrBinCache()
+{
+	DestroyLock(lock);
+}
+
+size_t SsocrBinCache::GetBytes(const SsocrMask &mask)
+{
+	return sizeof(Entry)+(size_t)mask.GetRowWords()*mask.GetHeight()*sizeof(MaskWord);
+}
+
+bool SsocrBinCache::Lookup(const Key &key, double &threshold, SsocrMask &mask)
+{
+	EnterLock(lock);
+	EntryMap::iterator it=index.find(key);
+	bool found=it!=index.end();
+	if (found) {
+		entries.splice(entries.begin(), entries, it->second);
+		threshold=it->second->threshold;
+		mask=it->second->mask;
+	}
+	LeaveLock(lock);
+	return found;
+}
+
+void SsocrBinCache::Insert(const Key &key, double threshold, const SsocrMask &mask)
+{
+	size_t entry_bytes=GetBytes(mask);
+
+	EnterLock(lock);
+	//Other instance could have inserted the same frame while this one was binarizing it
+	//Mask that doesn't fit into the budget alone would only flush the cache
+	if (index.find(key)==index.end()&&entry_bytes<=budget) {
+		entries.push_front(Entry());
+		entries.front().key=key;
+		entries.front().threshold=threshold;
+		entries.front().mask=mask;
+		entries.front().bytes=entry_bytes;
+		index[key]=entries.begin();
+		bytes+=entry_bytes;
+		Evict();
+	}
+	LeaveLock(lock);
+}
+
+void SsocrBinCache::Purge(const void *source)
+{
+	EnterLock(lock);
+	for (EntryList::iterator it=entries.begin(); it!=entries.end();) {
+		if (it->key.source==source) {
+			bytes-=it->bytes;
+			index.erase(it->key);
+			it=entries.erase(it);
+		} else
+			it++;
+	}
+	LeaveLock(lock);
+}
+
+void SsocrBinCache::ExtendBudget(size_t budget)
+{
+	EnterLock(lock);
+	if (budget>this->budget)
+		this->budget=budget;
+	LeaveLock(lock);
+}
+
+//Should be called with lock held
+void SsocrBinCache::Evict()
+{
+	while (bytes>budget&&!entries.empty()) {
+		bytes-=entries.back().bytes;
+		index.erase(entries.back().key);
+		entries.pop_back();
+	}
+}
+
+//Shared cache is created when the module is loaded, so it's ready before any filter is
+static SsocrBinCache shared_cache(0);
+
+SsocrBinCache &SsocrBinCache::GetShared()
+{
+	return shared_cache;
+}
\ No newline at end of file
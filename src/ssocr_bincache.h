@@ -0,0 +1,67 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SSOCR_BINCACHE_H
+#define SSOCR_BINCACHE_H
+
+#include <list>
+#include <map>
+#include <string>
+#include "ssocr_mask.h"
+
+//Process-wide LRU cache of binarized frames shared by all recognizers working on the same source
+//Total size of cached masks is kept under the byte budget, least recently used entries are evicted first
+//All methods lock the cache, masks are copied in and out so callers never hold references to entries
+class SsocrBinCache {
+public:
+	struct Key {
+		const void *source;		//Identity of the source (e.g. clip pointer), Purge removes all of it's entries
+		const void *context;	//Additional identity that distinguishes sources reusing the same address
+		int frame;
+		int x, y, w, h;			//Region of the frame that is binarized
+		std::string config;		//Threshold, polarity and cleanup settings
+		bool operator<(const Key &other) const;
+	};
+private:
+	struct Entry {
+		Key key;
+		double threshold;
+		SsocrMask mask;
+		size_t bytes;
+	};
+
+	typedef std::list<Entry> EntryList;
+	typedef std::map<Key, EntryList::iterator> EntryMap;
+
+	EntryList entries;			//Most recently used first
+	EntryMap index;
+	size_t bytes;
+	size_t budget;
+	void *lock;
+
+	void Evict();
+	static size_t GetBytes(const SsocrMask &mask);
+public:
+	SsocrBinCache(size_t budget);
+	~SsocrBinCache();
+	//Copies cached mask and it's threshold, returns false if key isn't cached
+	bool Lookup(const Key &key, double &threshold, SsocrMask &mask);
+	void Insert(const Key &key, double threshold, const SsocrMask &mask);
+	//Removes all entries of the source
+	void Purge(const void *source);
+	//Budget only grows, so instances sharing the cache get at least what they requested
+	void ExtendBudget(size_t budget);
+	static SsocrBinCache &GetShared();
+};
+
+#endif //SSOCR_BINCACHE_H
\ No newline at end of file
@@ -0,0 +1,71 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <fstream>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "ssocr_checkpoint.h"
+
+#ifdef _WIN32
+static bool RenameOver(const std::string &from, const std::string &to)
+{
+	return MoveFileEx(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING)!=0;
+}
+#else
+static bool RenameOver(const std::string &from, const std::string &to)
+{
+	return rename(from.c_str(), to.c_str())==0;
+}
+#endif
+
+SsocrCheckpoint::SsocrCheckpoint(const std::string &path):
+	path(path), last_save(SsocrTrace::Now()), period((SsocrTicks)(SsocrTrace::GetTickFrequency()*SSOCR_CHECKPOINT_PERIOD/1000))
+{}
+
+//File has one value per line: frame, log offset, config and recognizer state
+bool SsocrCheckpoint::Load(State &state) const
+{
+	std::ifstream file(path.c_str());
+	std::string frame, log_offset;
+	if (!std::getline(file, frame)||!std::getline(file, log_offset)||!std::getline(file, state.config)||!std::getline(file, state.recognizer))
+		return false;
+	if (sscanf(frame.c_str(), "%d", &state.frame)!=1||sscanf(log_offset.c_str(), "%lld", &state.log_offset)!=1)
+		return false;
+	return state.frame>=0&&state.log_offset>=0;
+}
+
+bool SsocrCheckpoint::Save(const State &state)
+{
+	std::string tmp_path=path+".tmp";
+	last_save=SsocrTrace::Now();
+	{
+		std::ofstream file(tmp_path.c_str(), std::ios::trunc);
+		file<<state.frame<<'\n'<<state.log_offset<<'\n'<<state.config<<'\n'<<state.recognizer<<'\n';
+		file.flush();
+		if (!file.good())
+			return false;
+	}
+	return RenameOver(tmp_path, path);
+}
+
+bool SsocrCheckpoint::IsDue() const
+{
+	return SsocrTrace::Now()-last_save>=period;
+}
+
+void SsocrCheckpoint::Remove()
+{
+	remove(path.c_str());
+}
\ No newline at end of file
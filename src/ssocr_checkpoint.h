@@ -0,0 +1,48 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SSOCR_CHECKPOINT_H
+#define SSOCR_CHECKPOINT_H
+
+#include <string>
+#include "ssocr_trace.h"
+
+/* period of checkpoint file updates in mseconds */
+#define SSOCR_CHECKPOINT_PERIOD 5000
+
+//Progress of long logging run, so it can be resumed after crash instead of started over
+//File is replaced atomically (temporary file is renamed over the old one), so it's either old or new one after crash
+class SsocrCheckpoint {
+public:
+	struct State {
+		int frame;				//Last frame that was processed, everything before it is in the log
+		long long log_offset;	//Log length after that frame
+		std::string config;		//Settings of the run, state is resumed only with the same ones
+		std::string recognizer;	//Recognizer state (see Ssocr::GetState)
+	};
+private:
+	std::string path;
+	SsocrTicks last_save;
+	SsocrTicks period;
+public:
+	SsocrCheckpoint(const std::string &path);
+	//Returns false if there is no checkpoint or it's malformed
+	bool Load(State &state) const;
+	bool Save(const State &state);
+	//True if SSOCR_CHECKPOINT_PERIOD has passed since last save
+	bool IsDue() const;
+	//Removes checkpoint of finished run
+	void Remove();
+};
+
+#endif //SSOCR_CHECKPOINT_H
\ No newline at end of file
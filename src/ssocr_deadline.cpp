@@ -0,0 +1,53 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ssocr_deadline.h"
+
+SsocrDeadline::SsocrDeadline(double budget):
+	budget(budget), ms_per_tick(1000.0/SsocrTrace::GetTickFrequency()), average(-1.0), level(FULL_QUALITY), held(0), sampled(0)
+{}
+
+SsocrDegradation SsocrDeadline::GetLevel() const
+{
+	return (SsocrDegradation)level;
+}
+
+//Skipped frame costs nothing, so raised interval lowers average time of sampled frames
+bool SsocrDeadline::Skip()
+{
+	if (level<RAISED_INTERVAL||!(sampled++%DEADLINE_INTERVAL_FACTOR))
+		return false;
+	AddTime(0.0);
+	return true;
+}
+
+void SsocrDeadline::AddFrame(SsocrTicks start)
+{
+	AddTime((SsocrTrace::Now()-start)*ms_per_tick);
+}
+
+/* level is held for a while after every change, so average reflects the new level before the next step */
+void SsocrDeadline::AddTime(double ms)
+{
+	average=average<0.0?ms:average+DEADLINE_ALPHA*(ms-average);
+	if (++held<DEADLINE_HOLD)
+		return;
+	if (average>budget&&level<RAISED_INTERVAL) {
+		level++;
+		held=0;
+		sampled=0;
+	} else if (average<budget*DEADLINE_RECOVER&&level>FULL_QUALITY) {
+		level--;
+		held=0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SSOCR_DEADLINE_H
+#define SSOCR_DEADLINE_H
+
+#include "ssocr_defines.h"
+#include "ssocr_trace.h"
+
+//Keeps recognition of live source within per-frame latency budget by trading accuracy for time
+//Degradation level (see SsocrDegradation in ssocr_defines.h) is raised one step at a time while smoothed recognition time
+//of sampled frames is over budget and lowered back when it falls well below it
+class SsocrDeadline {
+private:
+	double budget;				//Mseconds per sampled frame
+	double ms_per_tick;
+	double average;				//Smoothed recognition time, negative until first frame
+	int level;
+	int held;					//Sampled frames since last level change
+	unsigned int sampled;		//Sampled frames at RAISED_INTERVAL level
+
+	void AddTime(double ms);
+public:
+	SsocrDeadline(double budget);
+	SsocrDegradation GetLevel() const;
+	//Called for every sampled frame before it's recognized, true if it should be skipped at current level
+	bool Skip();
+	//Records recognition of sampled frame started at start (see SsocrTrace::Now)
+	void AddFrame(SsocrTicks start);
+};
+
+#endif //SSOCR_DEADLINE_H
\ No newline at end of file
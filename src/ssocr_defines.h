@@ -27,6 +27,22 @@
 #define OCRF_LOCALIZED_OUTPUT true
 #define OCRF_INVERTED false
 #define OCRF_THRESHOLD "50"
+#define OCRF_TRACE_FILE ""
+#define OCRF_METRICS_FILE ""
+#define OCRF_SPARSE false
+#define OCRF_MEMOIZE true
+#define OCRF_LOG_SORTED false
+#define OCRF_CLEANUP ""
+#define OCRF_CACHE_SIZE 64
+#define OCRF_TRACK false
+#define OCRF_THREADS 1
+#define OCRF_PREFETCH 0
+#define OCRF_CACHE_FILE ""
+#define OCRF_CHECKPOINT ""
+#define OCRF_GLYPH_CACHE 0
+#define OCRF_CLASSIFIER "scanline"
+#define OCRF_BUDGET 0.0
+#define OCRF_FIELD -1
 
 /* a one is recognized by width/height ratio < ONE_RATIO */
 #define ONE_RATIO_NUM 1
@@ -97,9 +113,73 @@
 #define D_HEX_F (ALL_SEGS & ~(VERT_RIGHT_UP | VERT_RIGHT_DOWN | HORIZ_DOWN))
 #define D_UNKNOWN 0
 
+/* temporal threshold: luminance range is sampled at every TEMPORAL_STEP-th row and column,
+* smoothed across frames with TEMPORAL_ALPHA weight of the current frame and is measured
+* on the full frame again when sampled range drifts more than TEMPORAL_DRIFT */
+#define TEMPORAL_STEP 4
+#define TEMPORAL_ALPHA 0.25
+#define TEMPORAL_DRIFT 16
+
+/* local threshold: window side is 1/LOCAL_WINDOW_DIV of the smaller image dimension,
+* but at least 2*LOCAL_MIN_RADIUS+1 pixels */
+#define LOCAL_WINDOW_DIV 6
+#define LOCAL_MIN_RADIUS 7
+
+/* dynamic range of standard deviation in Sauvola threshold */
+#define SAUVOLA_R 128.0
+
+/* Niblack threshold also requires pixel to differ at least this much from window mean,
+* otherwise background noise near the edges of digits becomes foreground */
+#define NIBLACK_MIN_CONTRAST 16.0
+
+/* glyph cache: digit cell is sampled in the centers of GLYPH_W x GLYPH_H grid, so cells of any size
+* map to fixed fingerprint of GLYPH_W*GLYPH_H bits (multiple of 32) */
+#define GLYPH_W 8
+#define GLYPH_H 16
+
+/* template classifier: cell fingerprint (see GLYPH_W and GLYPH_H) matches template if they differ in at most
+* TEMPLATE_MAX_DISTANCE bits, built-in templates are drawn with segments TEMPLATE_THICKNESS of digit height thick,
+* learned template replaces built-in one if glyph was decoded at least TEMPLATE_MIN_SAMPLES times while learning */
+#define TEMPLATE_MAX_DISTANCE 24
+#define TEMPLATE_THICKNESS 0.125
+#define TEMPLATE_MIN_SAMPLES 3
+
+/* deadline scheduler: recognition time of sampled frames is smoothed with DEADLINE_ALPHA weight of the current frame,
+* degradation level is raised when it's over budget and lowered when it's below DEADLINE_RECOVER of the budget,
+* level is kept for at least DEADLINE_HOLD sampled frames after every change,
+* degraded adaptive threshold samples every DEADLINE_RANGE_STEP-th row and column,
+* degraded column profile counts every DEADLINE_ROW_STEP-th row, at the highest level only every
+* DEADLINE_INTERVAL_FACTOR-th sampled frame is recognized */
+#define DEADLINE_ALPHA 0.25
+#define DEADLINE_RECOVER 0.5
+#define DEADLINE_HOLD 8
+#define DEADLINE_RANGE_STEP 4
+#define DEADLINE_ROW_STEP 2
+#define DEADLINE_INTERVAL_FACTOR 2
+
+/* display tracking works on luminance downsampled TRACK_SCALE times in both directions,
+* display is searched for in TRACK_SEARCH downsampled pixels around its last position
+* and is lost when mean absolute difference of the best match exceeds TRACK_LOST_DIFF,
+* display is localized again after TRACK_REFRESH tracked frames to catch changes of layout (e.g. new leading digit) */
+#define TRACK_SCALE 4
+#define TRACK_SEARCH 4
+#define TRACK_LOST_DIFF 24.0
+#define TRACK_REFRESH 100
+
+/* display localization: segment-like blobs differ at least LOCATE_CONTRAST from the mean of
+* the window with side of 1/LOCATE_WINDOW_DIV of the smaller downsampled image dimension,
+* digits are at least LOCATE_MIN_HEIGHT downsampled pixels high,
+* found display is enlarged by LOCATE_MARGIN of its height on every side */
+#define LOCATE_CONTRAST 24
+#define LOCATE_WINDOW_DIV 8
+#define LOCATE_MIN_HEIGHT 3
+#define LOCATE_MARGIN 0.125
+
 /* various enums */
-enum SsocrThreshold {ABSOLUTE_THRESHOLD, ITERATIVE_THRESHOLD, ADAPTIVE_THRESHOLD};
+enum SsocrThreshold {ABSOLUTE_THRESHOLD, ITERATIVE_THRESHOLD, ADAPTIVE_THRESHOLD, TEMPORAL_THRESHOLD, SAUVOLA_THRESHOLD, NIBLACK_THRESHOLD};
 enum SsocrStates {DARK, LIGHT, UNKNOWN};
+enum SsocrClassifier {SCANLINE_CLASSIFIER, TEMPLATE_CLASSIFIER};
+enum SsocrDegradation {FULL_QUALITY, FAST_THRESHOLD, SUBSAMPLED_ROWS, RAISED_INTERVAL};
 
 /* maximum RGB component value */
 #define MAXRGB 255
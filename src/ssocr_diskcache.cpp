@@ -0,0 +1,377 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <map>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "ssocr_diskcache.h"
+
+#define DISKCACHE_MAGIC "SSOCRDC"
+
+/* MurmurHash64A mixing */
+#define HASH_M 0xc6a4a7935bd1e995ULL
+#define HASH_R 47
+
+#ifdef _WIN32
+struct SsocrDiskCache::Native {
+	HANDLE file;
+	HANDLE mapping;
+};
+
+static void *CreateLock()
+{
+	CRITICAL_SECTION *cs=new CRITICAL_SECTION;
+	InitializeCriticalSection(cs);
+	return cs;
+}
+
+static void DestroyLock(void *lock)
+{
+	DeleteCriticalSection((CRITICAL_SECTION*)lock);
+	delete (CRITICAL_SECTION*)lock;
+}
+
+static void EnterLock(void *lock)
+{
+	EnterCriticalSection((CRITICAL_SECTION*)lock);
+}
+
+static void LeaveLock(void *lock)
+{
+	LeaveCriticalSection((CRITICAL_SECTION*)lock);
+}
+
+bool SsocrDiskCache::OpenFile()
+{
+	native->file=CreateFile(path.c_str(), GENERIC_READ|GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	native->mapping=NULL;
+	return native->file!=INVALID_HANDLE_VALUE;
+}
+
+void SsocrDiskCache::CloseFile()
+{
+	if (native->file!=INVALID_HANDLE_VALUE)
+		CloseHandle(native->file);
+	native->file=INVALID_HANDLE_VALUE;
+}
+
+size_t SsocrDiskCache::GetFileLength()
+{
+	DWORD high=0;
+	DWORD low=::GetFileSize(native->file, &high);
+	return low==INVALID_FILE_SIZE||high?0:low;
+}
+
+bool SsocrDiskCache::Map(size_t size)
+{
+	if (SetFilePointer(native->file, (LONG)size, NULL, FILE_BEGIN)==INVALID_SET_FILE_POINTER||!SetEndOfFile(native->file))
+		return false;
+	if (!(native->mapping=CreateFileMapping(native->file, NULL, PAGE_READWRITE, 0, (DWORD)size, NULL)))
+		return false;
+	if (!(header=(Header*)MapViewOfFile(native->mapping, FILE_MAP_WRITE, 0, 0, size))) {
+		CloseHandle(native->mapping);
+		native->mapping=NULL;
+		return false;
+	}
+	slots=(Slot*)(header+1);
+	return true;
+}
+
+void SsocrDiskCache::Unmap()
+{
+	if (header) {
+		UnmapViewOfFile(header);
+		CloseHandle(native->mapping);
+	}
+	native->mapping=NULL;
+	header=NULL;
+	slots=NULL;
+}
+#else
+struct SsocrDiskCache::Native {
+	int fd;
+	size_t size;
+};
+
+static void *CreateLock()
+{
+	pthread_mutex_t *mutex=new pthread_mutex_t;
+	pthread_mutex_init(mutex, NULL);
+	return mutex;
+}
+
+static void DestroyLock(void *lock)
+{
+	pthread_mutex_destroy((pthread_mutex_t*)lock);
+	delete (pthread_mutex_t*)lock;
+}
+
+static void EnterLock(void *lock)
+{
+	pthread_mutex_lock((pthread_mutex_t*)lock);
+}
+
+static void LeaveLock(void *lock)
+{
+	pthread_mutex_unlock((pthread_mutex_t*)lock);
+}
+
+bool SsocrDiskCache::OpenFile()
+{
+	native->fd=open(path.c_str(), O_RDWR|O_CREAT, 0644);
+	native->size=0;
+	return native->fd>=0;
+}
+
+void SsocrDiskCache::CloseFile()
+{
+	if (native->fd>=0)
+		close(native->fd);
+	native->fd=-1;
+}
+
+size_t SsocrDiskCache::GetFileLength()
+{
+	struct stat st;
+	return fstat(native->fd, &st)?0:st.st_size;
+}
+
+bool SsocrDiskCache::Map(size_t size)
+{
+	if (ftruncate(native->fd, size))
+		return false;
+	void *data=mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, native->fd, 0);
+	if (data==MAP_FAILED)
+		return false;
+	native->size=size;
+	header=(Header*)data;
+	slots=(Slot*)(header+1);
+	return true;
+}
+
+void SsocrDiskCache::Unmap()
+{
+	if (header)
+		munmap(header, native->size);
+	native->size=0;
+	header=NULL;
+	slots=NULL;
+}
+#endif
+
+//Caches that are open in the process by path, registry lock is created when the module is loaded
+static std::map<std::string, SsocrDiskCache*> registry;
+static void *registry_lock=CreateLock();
+
+SsocrDiskCache::SsocrDiskCache(const std::string &path):
+	native(new Native()), path(path), header(NULL), slots(NULL), refs(1), lock(CreateLock())
+{}
+
+SsocrDiskCache::~SsocrDiskCache()
+{
+	Unmap();
+	CloseFile();
+	DestroyLock(lock);
+	delete native;
+}
+
+SsocrDiskCache *SsocrDiskCache::Open(const std::string &path)
+{
+	EnterLock(registry_lock);
+	std::map<std::string, SsocrDiskCache*>::iterator it=registry.find(path);
+	SsocrDiskCache *cache=NULL;
+	if (it!=registry.end()) {
+		cache=it->second;
+		cache->refs++;
+	} else {
+		cache=new SsocrDiskCache(path);
+		if (cache->OpenFile()&&cache->Load()) {
+			registry[path]=cache;
+		} else {
+			delete cache;
+			cache=NULL;
+		}
+	}
+	LeaveLock(registry_lock);
+	return cache;
+}
+
+void SsocrDiskCache::Close(SsocrDiskCache *cache)
+{
+	if (!cache)
+		return;
+	EnterLock(registry_lock);
+	if (!--cache->refs) {
+		registry.erase(cache->path);
+		delete cache;
+	}
+	LeaveLock(registry_lock);
+}
+
+size_t SsocrDiskCache::GetSize(unsigned int bits)
+{
+	return sizeof(Header)+(sizeof(Slot)<<bits);
+}
+
+//Existing file is used if it has valid header and expected size, otherwise it's recreated empty
+bool SsocrDiskCache::Load()
+{
+	size_t size=GetFileLength();
+	if (size>=sizeof(Header)&&Map(size)) {
+		if (!memcmp(header->magic, DISKCACHE_MAGIC, sizeof(DISKCACHE_MAGIC))&&header->version==SSOCR_DISKCACHE_VERSION&&
+			header->bits>=SSOCR_DISKCACHE_MIN_BITS&&header->bits<=SSOCR_DISKCACHE_MAX_BITS&&size==GetSize(header->bits))
+			return true;
+		Unmap();
+	}
+	return Reset(SSOCR_DISKCACHE_MIN_BITS);
+}
+
+bool SsocrDiskCache::Reset(unsigned int bits)
+{
+	if (!Map(GetSize(bits)))
+		return false;
+	memset(header, 0, GetSize(bits));
+	memcpy(header->magic, DISKCACHE_MAGIC, sizeof(DISKCACHE_MAGIC));
+	header->version=SSOCR_DISKCACHE_VERSION;
+	header->bits=bits;
+	header->count=0;
+	return true;
+}
+
+//Table is rehashed into file of doubled size, cache is disabled if file can't be resized
+bool SsocrDiskCache::Grow()
+{
+	if (header->bits>=SSOCR_DISKCACHE_MAX_BITS)
+		return false;
+
+	unsigned int bits=header->bits+1;
+	std::vector<Slot> used;
+	for (size_t s=0; s<((size_t)1<<header->bits); s++)
+		if (slots[s].used)
+			used.push_back(slots[s]);
+	Unmap();
+	if (!Reset(bits))
+		return false;
+	for (std::vector<Slot>::iterator it=used.begin(); it!=used.end(); it++) {
+		*Find(it->content, it->config)=*it;
+		header->count++;
+	}
+	return true;
+}
+
+//Returns slot of the key or empty slot where it should be inserted, NULL if table of damaged file is full
+SsocrDiskCache::Slot *SsocrDiskCache::Find(SsocrHash content, SsocrHash config)
+{
+	size_t mask=((size_t)1<<header->bits)-1;
+	size_t s=(size_t)(content^(config*HASH_M))&mask;
+	for (size_t probe=0; probe<=mask; probe++, s=(s+1)&mask)
+		if (!slots[s].used||(slots[s].content==content&&slots[s].config==config))
+			return &slots[s];
+	return NULL;
+}
+
+bool SsocrDiskCache::Lookup(SsocrHash content, SsocrHash config, std::string &digits)
+{
+	bool found=false;
+	EnterLock(lock);
+	if (header) {
+		Slot *slot=Find(content, config);
+		if ((found=slot&&slot->used)) {
+			slot->digits[SSOCR_DISKCACHE_DIGITS-1]='\0';
+			digits=slot->digits;
+		}
+	}
+	LeaveLock(lock);
+	return found;
+}
+
+void SsocrDiskCache::Insert(SsocrHash content, SsocrHash config, const std::string &digits)
+{
+	if (digits.length()>=SSOCR_DISKCACHE_DIGITS)
+		return;
+
+	EnterLock(lock);
+	//Load is kept below 3/4, so probe sequences stay short
+	if (header&&(header->count+1)*4>(3u<<header->bits))
+		Grow();
+	if (header&&(header->count+1)*4<=(3u<<header->bits)) {
+		Slot *slot=Find(content, config);
+		if (slot&&!slot->used) {
+			slot->content=content;
+			slot->config=config;
+			memset(slot->digits, 0, SSOCR_DISKCACHE_DIGITS);
+			memcpy(slot->digits, digits.c_str(), digits.length());
+			slot->used=1;
+			header->count++;
+		}
+	}
+	LeaveLock(lock);
+}
+
+static inline SsocrHash MixWord(SsocrHash hash, SsocrHash k)
+{
+	k*=HASH_M;
+	k^=k>>HASH_R;
+	k*=HASH_M;
+	hash^=k;
+	return hash*HASH_M;
+}
+
+//Bytes are taken in 8-byte words, tail of the buffer is packed into the last word
+static SsocrHash HashBytes(SsocrHash hash, const unsigned char *data, size_t len)
+{
+	size_t i=0;
+	for (; i+8<=len; i+=8) {
+		SsocrHash k;
+		memcpy(&k, data+i, 8);
+		hash=MixWord(hash, k);
+	}
+	if (i<len) {
+		SsocrHash k=0;
+		for (size_t j=0; i+j<len; j++)
+			k|=(SsocrHash)data[i+j]<<(8*j);
+		hash=MixWord(hash, k);
+	}
+	return hash;
+}
+
+static SsocrHash FinalizeHash(SsocrHash hash)
+{
+	hash^=hash>>HASH_R;
+	hash*=HASH_M;
+	hash^=hash>>HASH_R;
+	return hash;
+}
+
+SsocrHash SsocrDiskCache::HashLuma(const YuvImg &img)
+{
+	const YuvImg::PlaneData &luma=img.GetPlanes()[0];
+	SsocrHash hash=MixWord(0, ((SsocrHash)img.GetWidth()<<40)^((SsocrHash)img.GetHeight()<<16)^img.GetBitDepth());
+	for (int y=0; y<img.GetHeight(); y++)
+		hash=HashBytes(hash, luma.ptr+luma.pitch*y, luma.width);
+	return FinalizeHash(hash);
+}
+
+SsocrHash SsocrDiskCache::HashString(const std::string &str)
+{
+	return FinalizeHash(HashBytes(MixWord(0, str.length()), (const unsigned char*)str.data(), str.length()));
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SSOCR_DISKCACHE_H
+#define SSOCR_DISKCACHE_H
+
+#include <string>
+#include "yuvimg.h"
+
+/* should be incremented when recognition changes in a way that makes results of old cache files stale */
+#define SSOCR_DISKCACHE_VERSION 1
+
+/* table holds 1<<bits slots, it's doubled when it's 3/4 full until it reaches maximum size (64 MB) */
+#define SSOCR_DISKCACHE_MIN_BITS 14
+#define SSOCR_DISKCACHE_MAX_BITS 20
+
+/* longer results aren't cached */
+#define SSOCR_DISKCACHE_DIGITS 47
+
+typedef unsigned long long SsocrHash;
+
+//Recognition results persisted in memory mapped file between runs
+//Results are keyed by hash of luminance of recognized region and hash of recognizer settings,
+//so entry made with other settings or for other image is never found and stale entries simply stay unused
+//File is an open addressing hash table with linear probing, file with wrong header is silently recreated
+//Caches are shared by path within the process and are thread-safe, but file shouldn't be used by several processes at once
+class SsocrDiskCache {
+private:
+	struct Header {
+		char magic[8];
+		unsigned int version;
+		unsigned int bits;			//Table has 1<<bits slots
+		unsigned int count;			//Used slots
+		unsigned int reserved[11];
+	};
+
+	struct Slot {
+		SsocrHash content;
+		SsocrHash config;
+		unsigned char used;
+		char digits[SSOCR_DISKCACHE_DIGITS];	//Zero terminated
+	};
+
+	struct Native;					//File and mapping handles
+	Native *native;
+	std::string path;
+	Header *header;					//NULL if file can't be mapped
+	Slot *slots;
+	int refs;
+	void *lock;
+
+	SsocrDiskCache(const std::string &path);
+	~SsocrDiskCache();
+	bool OpenFile();
+	void CloseFile();
+	size_t GetFileLength();
+	//Resizes file to size and maps it
+	bool Map(size_t size);
+	void Unmap();
+	bool Load();
+	bool Reset(unsigned int bits);
+	bool Grow();
+	Slot *Find(SsocrHash content, SsocrHash config);
+	static size_t GetSize(unsigned int bits);
+public:
+	//Returns cache of the path (file is created if it doesn't exist) or NULL if file can't be opened, should be paired with Close
+	static SsocrDiskCache *Open(const std::string &path);
+	static void Close(SsocrDiskCache *cache);
+	bool Lookup(SsocrHash content, SsocrHash config, std::string &digits);
+	void Insert(SsocrHash content, SsocrHash config, const std::string &digits);
+	//Hash of luminance plane together with it's size and bit depth
+	static SsocrHash HashLuma(const YuvImg &img);
+	static SsocrHash HashString(const std::string &str);
+};
+
+#endif //SSOCR_DISKCACHE_H
\ No newline at end of file
@@ -0,0 +1,119 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ssocr_glyphcache.h"
+
+bool SsocrGlyphCache::Key::operator<(const Key &other) const
+{
+	for (int i=0; i<GLYPH_W*GLYPH_H/32; i++)
+		if (bits[i]!=other.bits[i])
+			return bits[i]<other.bits[i];
+	if (w!=other.w)
+		return w<other.w;
+	if (h!=other.h)
+		return h<other.h;
+	return max_h<other.max_h;
+}
+
+SsocrGlyphCache::SsocrGlyphCache(size_t capacity):
+	entries(), index(), capacity(capacity), head(-1), tail(-1), hits(0), lookups(0)
+{}
+
+void SsocrGlyphCache::SetCapacity(size_t capacity)
+{
+	Clear();
+	this->capacity=capacity;
+}
+
+void SsocrGlyphCache::Clear()
+{
+	entries.clear();
+	index.clear();
+	head=tail=-1;
+}
+
+bool SsocrGlyphCache::IsEnabled() const
+{
+	return capacity>0;
+}
+
+void SsocrGlyphCache::Unlink(int e)
+{
+	if (entries[e].prev>=0)
+		entries[entries[e].prev].next=entries[e].next;
+	else
+		head=entries[e].next;
+	if (entries[e].next>=0)
+		entries[entries[e].next].prev=entries[e].prev;
+	else
+		tail=entries[e].prev;
+}
+
+void SsocrGlyphCache::PushFront(int e)
+{
+	entries[e].prev=-1;
+	entries[e].next=head;
+	if (head>=0)
+		entries[head].prev=e;
+	head=e;
+	if (tail<0)
+		tail=e;
+}
+
+bool SsocrGlyphCache::Lookup(const Key &key, int &digit)
+{
+	lookups++;
+	std::map<Key, int>::iterator it=index.find(key);
+	if (it==index.end())
+		return false;
+	hits++;
+	Unlink(it->second);
+	PushFront(it->second);
+	digit=entries[it->second].digit;
+	return true;
+}
+
+void SsocrGlyphCache::Insert(const Key &key, int digit)
+{
+	if (!capacity)
+		return;
+	std::map<Key, int>::iterator it=index.find(key);
+	if (it!=index.end()) {
+		entries[it->second].digit=digit;
+		return;
+	}
+	int e;
+	if (entries.size()<capacity) {
+		e=(int)entries.size();
+		entries.push_back(Entry());
+	} else {
+		//Least recently used entry is reused
+		e=tail;
+		Unlink(e);
+		index.erase(entries[e].key);
+	}
+	entries[e].key=key;
+	entries[e].digit=digit;
+	PushFront(e);
+	index[key]=e;
+}
+
+unsigned long SsocrGlyphCache::GetHits() const
+{
+	return hits;
+}
+
+unsigned long SsocrGlyphCache::GetLookups() const
+{
+	return lookups;
+}
\ No newline at end of file
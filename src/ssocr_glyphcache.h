@@ -0,0 +1,64 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SSOCR_GLYPHCACHE_H
+#define SSOCR_GLYPHCACHE_H
+
+#include <cstddef>
+#include <map>
+#include <vector>
+#include "ssocr_defines.h"
+
+//Decoded glyphs of digit cells keyed by their fingerprint: cell sampled on GLYPH_W x GLYPH_H grid, cell size and maximum digit height
+//Display shows the same few patterns in every cell, so most cells are decoded without scanning segments
+//Holds at most capacity entries, least recently used one is replaced when it's full
+//Entries are linked by indices, so cache (and recognizer owning it) can be copied
+class SsocrGlyphCache {
+public:
+	struct Key {
+		unsigned int bits[GLYPH_W*GLYPH_H/32];
+		int w, h;				//Cell size, ratio classification depends on it
+		int max_h;				//Maximum digit height of the frame, colon and decimal point depend on it
+		bool operator<(const Key &other) const;
+	};
+private:
+	struct Entry {
+		Key key;
+		int digit;
+		int prev, next;			//Neighbours in LRU list, -1 at the ends
+	};
+
+	std::vector<Entry> entries;
+	std::map<Key, int> index;
+	size_t capacity;
+	int head, tail;				//Most and least recently used entries
+	unsigned long hits;
+	unsigned long lookups;
+
+	void Unlink(int e);
+	void PushFront(int e);
+public:
+	//Cache with zero capacity is disabled
+	SsocrGlyphCache(size_t capacity=0);
+	void SetCapacity(size_t capacity);
+	//Removes all entries, statistics are kept
+	void Clear();
+	bool IsEnabled() const;
+	//Returns false if key isn't cached
+	bool Lookup(const Key &key, int &digit);
+	void Insert(const Key &key, int digit);
+	unsigned long GetHits() const;
+	unsigned long GetLookups() const;
+};
+
+#endif //SSOCR_GLYPHCACHE_H
\ No newline at end of file
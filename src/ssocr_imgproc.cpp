@@ -12,14 +12,424 @@
 * along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <math.h>
-#include <windows.h>
+#include <string.h>
+#include <vector>
+#if defined(__SSE2__)||defined(_M_X64)||(defined(_M_IX86_FP)&&_M_IX86_FP>=2)
+#define SSOCR_SSE2
+#include <emmintrin.h>
+#endif
 #include "ssocr_imgproc.h"
 
-SsocrImg::SsocrImg(const PVideoFrame &src, const VideoInfo &vi):
-	YuvImg(src, vi)
+SsocrImg::SsocrImg(const PlaneData *planes, int width, int height, bool read_only):
+	YuvImg(planes, width, height, read_only), mask(NULL), pool(NULL)
 {}
 
+/* add (sign=1) or subtract (sign=-1) luminance and squared luminance of the row to column sums */
+static void accumulate_row(const unsigned char *row, int w, int sign, unsigned int *sum, unsigned int *sq)
+{
+	int x=0;
+#ifdef SSOCR_SSE2
+	/* 16 pixels per iteration, squares of 8-bit values fit into unsigned 16-bit */
+	__m128i zero=_mm_setzero_si128();
+	for (; x+16<=w; x+=16) {
+		__m128i lum=_mm_loadu_si128((const __m128i*)(row+x));
+		__m128i lum16[2]={_mm_unpacklo_epi8(lum, zero), _mm_unpackhi_epi8(lum, zero)};
+		for (int half=0; half<2; half++) {
+			__m128i sq16=_mm_mullo_epi16(lum16[half], lum16[half]);
+			__m128i lum32[2]={_mm_unpacklo_epi16(lum16[half], zero), _mm_unpackhi_epi16(lum16[half], zero)};
+			__m128i sq32[2]={_mm_unpacklo_epi16(sq16, zero), _mm_unpackhi_epi16(sq16, zero)};
+			for (int quarter=0; quarter<2; quarter++) {
+				__m128i *sum_ptr=(__m128i*)(sum+x+half*8+quarter*4);
+				__m128i *sq_ptr=(__m128i*)(sq+x+half*8+quarter*4);
+				if (sign>0) {
+					_mm_storeu_si128(sum_ptr, _mm_add_epi32(_mm_loadu_si128(sum_ptr), lum32[quarter]));
+					_mm_storeu_si128(sq_ptr, _mm_add_epi32(_mm_loadu_si128(sq_ptr), sq32[quarter]));
+				} else {
+					_mm_storeu_si128(sum_ptr, _mm_sub_epi32(_mm_loadu_si128(sum_ptr), lum32[quarter]));
+					_mm_storeu_si128(sq_ptr, _mm_sub_epi32(_mm_loadu_si128(sq_ptr), sq32[quarter]));
+				}
+			}
+		}
+	}
+#endif
+	for (; x<w; x++) {
+		sum[x]+=sign*row[x];
+		sq[x]+=sign*row[x]*row[x];
+	}
+}
+
+/* slide window of column sums down by one row: add luminance and squared luminance of row add and subtract ones of row sub,
+* column sums are read and written once instead of twice */
+static void slide_rows(const unsigned char *add, const unsigned char *sub, int w, unsigned int *sum, unsigned int *sq)
+{
+	int x=0;
+#ifdef SSOCR_SSE2
+	/* 8 pixels per iteration, squares of 8-bit values fit into unsigned 16-bit, differences are taken in 32 bits */
+	__m128i zero=_mm_setzero_si128();
+	for (; x+8<=w; x+=8) {
+		__m128i lum_add=_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(add+x)), zero);
+		__m128i lum_sub=_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(sub+x)), zero);
+		__m128i sq_add=_mm_mullo_epi16(lum_add, lum_add);
+		__m128i sq_sub=_mm_mullo_epi16(lum_sub, lum_sub);
+		__m128i lum_diff[2]={_mm_sub_epi32(_mm_unpacklo_epi16(lum_add, zero), _mm_unpacklo_epi16(lum_sub, zero)), _mm_sub_epi32(_mm_unpackhi_epi16(lum_add, zero), _mm_unpackhi_epi16(lum_sub, zero))};
+		__m128i sq_diff[2]={_mm_sub_epi32(_mm_unpacklo_epi16(sq_add, zero), _mm_unpacklo_epi16(sq_sub, zero)), _mm_sub_epi32(_mm_unpackhi_epi16(sq_add, zero), _mm_unpackhi_epi16(sq_sub, zero))};
+		for (int half=0; half<2; half++) {
+			__m128i *sum_ptr=(__m128i*)(sum+x+half*4);
+			__m128i *sq_ptr=(__m128i*)(sq+x+half*4);
+			_mm_storeu_si128(sum_ptr, _mm_add_epi32(_mm_loadu_si128(sum_ptr), lum_diff[half]));
+			_mm_storeu_si128(sq_ptr, _mm_add_epi32(_mm_loadu_si128(sq_ptr), sq_diff[half]));
+		}
+	}
+#endif
+	for (; x<w; x++) {
+		sum[x]+=add[x]-sub[x];
+		sq[x]+=add[x]*add[x]-sub[x]*sub[x];
+	}
+}
+
+/* add (sign=1) or subtract (sign=-1) luminance and squared luminance of the row to column sums, squares of 16-bit values don't fit 32 bits */
+static void accumulate_row(const unsigned short *row, int w, int sign, double *sum, double *sq)
+{
+	for (int x=0; x<w; x++) {
+		sum[x]+=sign*(double)row[x];
+		sq[x]+=sign*(double)row[x]*row[x];
+	}
+}
+
+static void slide_rows(const unsigned short *add, const unsigned short *sub, int w, double *sum, double *sq)
+{
+	accumulate_row(sub, w, -1, sum, sq);
+	accumulate_row(add, w, 1, sum, sq);
+}
+
+/* binarize whole mask words of the row with SIMD, returns number of processed pixels */
+#ifdef SSOCR_SSE2
+static int binarize_words(const unsigned char *row, int w, int lum_limit, MaskWord invert, MaskWord *mask_row)
+{
+	int x=0;
+	/* lum<lum_limit is the same as max(lum, lum_limit-1)==lum_limit-1, movemask packs 16 results at once */
+	if (lum_limit>0&&lum_limit<=MAXRGB) {
+		__m128i below=_mm_set1_epi8((char)(lum_limit-1));
+		for (; x+MASK_WORD_BITS<=w; x+=MASK_WORD_BITS) {
+			MaskWord word=0;
+			for (int part=0; part<MASK_WORD_BITS/16; part++) {
+				__m128i lum=_mm_loadu_si128((const __m128i*)(row+x+part*16));
+				word|=(MaskWord)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(lum, below), below))<<(part*16);
+			}
+			mask_row[x/MASK_WORD_BITS]=word^invert;
+		}
+	}
+	return x;
+}
+
+static int binarize_words(const unsigned short *row, int w, int lum_limit, MaskWord invert, MaskWord *mask_row)
+{
+	int x=0;
+	/* unsigned lum<lum_limit is signed comparison of both sides shifted by 0x8000, results of 16 pixels are packed to bytes for movemask */
+	if (lum_limit>0&&lum_limit<=0xFFFF) {
+		__m128i shift=_mm_set1_epi16((short)0x8000);
+		__m128i limit=_mm_set1_epi16((short)(lum_limit^0x8000));
+		for (; x+MASK_WORD_BITS<=w; x+=MASK_WORD_BITS) {
+			MaskWord word=0;
+			for (int part=0; part<MASK_WORD_BITS/16; part++) {
+				__m128i lo=_mm_xor_si128(_mm_loadu_si128((const __m128i*)(row+x+part*16)), shift);
+				__m128i hi=_mm_xor_si128(_mm_loadu_si128((const __m128i*)(row+x+part*16+8)), shift);
+				word|=(MaskWord)(unsigned int)_mm_movemask_epi8(_mm_packs_epi16(_mm_cmplt_epi16(lo, limit), _mm_cmplt_epi16(hi, limit)))<<(part*16);
+			}
+			mask_row[x/MASK_WORD_BITS]=word^invert;
+		}
+	}
+	return x;
+}
+#else
+template <class Sample>
+static int binarize_words(const Sample *row, int w, int lum_limit, MaskWord invert, MaskWord *mask_row)
+{
+	return 0;
+}
+#endif
+
+/* strip tasks are instantiated for 8-bit (unsigned char) and 16-bit (unsigned short) samples,
+* image rows are given by pointer to the first pixel of the processed area and pitch in bytes */
+
+/* minimum and maximum luminance of every step-th pixel of every row of the strip */
+template <class Sample>
+class RangeTask: public SsocrStripTask {
+private:
+	const unsigned char *ptr;
+	int pitch, w, step;
+public:
+	std::vector<int> minlum, maxlum; /* range of every strip */
+
+	RangeTask(const unsigned char *ptr, int pitch, int w, int step, int max_lum, int strips):
+		ptr(ptr), pitch(pitch), w(w), step(step), minlum(strips, max_lum), maxlum(strips, 0) {}
+	void Run(int strip, int y1, int y2)
+	{
+		int minval=minlum[strip], maxval=0;
+		for (int y=y1; y<y2; y++) {
+			const Sample *row=(const Sample*)(ptr+pitch*y);
+			if (step==1) {
+				/* branch-free loop is vectorized by compiler */
+				for (int x=0; x<w; x++) {
+					int lum=row[x];
+					minval=lum<minval?lum:minval;
+					maxval=lum>maxval?lum:maxval;
+				}
+			} else {
+				for (int x=0; x<w; x+=step) {
+					int lum=row[x];
+					minval=lum<minval?lum:minval;
+					maxval=lum>maxval?lum:maxval;
+				}
+			}
+		}
+		minlum[strip]=minval;
+		maxlum[strip]=maxval;
+	}
+};
+
+/* luminance histogram of every strip, there is a bin for every value of the bit depth,
+* bits above the bit depth are masked off so malformed samples can't get out of histogram */
+template <class Sample>
+class HistogramTask: public SsocrStripTask {
+private:
+	const unsigned char *ptr;
+	int pitch, w;
+	int max_lum;
+public:
+	int bins;
+	std::vector<unsigned int> histograms; /* bins of every strip */
+
+	HistogramTask(const unsigned char *ptr, int pitch, int w, int max_lum, int strips):
+		ptr(ptr), pitch(pitch), w(w), max_lum(max_lum), bins(max_lum+1), histograms(strips*bins, 0) {}
+	void Run(int strip, int y1, int y2)
+	{
+		/* neighbouring pixels of flat background have the same luminance, so they are counted in separate
+		* partial histograms to avoid waiting for the previous increment of the same bin */
+		std::vector<unsigned int> partial(4*bins, 0);
+		for (int y=y1; y<y2; y++) {
+			const Sample *row=(const Sample*)(ptr+pitch*y);
+			int x=0;
+			for (; x+4<=w; x+=4) {
+				partial[row[x]&max_lum]++;
+				partial[bins+(row[x+1]&max_lum)]++;
+				partial[2*bins+(row[x+2]&max_lum)]++;
+				partial[3*bins+(row[x+3]&max_lum)]++;
+			}
+			for (; x<w; x++)
+				partial[row[x]&max_lum]++;
+		}
+		unsigned int *histogram=&histograms[strip*bins];
+		for (int lum=0; lum<bins; lum++)
+			histogram[lum]=partial[lum]+partial[bins+lum]+partial[2*bins+lum]+partial[3*bins+lum];
+	}
+};
+
+/* rows of the mask are binarized with global threshold independently */
+template <class Sample>
+class BinarizeTask: public SsocrStripTask {
+private:
+	const unsigned char *ptr;
+	int pitch, w;
+	int lum_limit; /* integer luminance below lum_limit is dark */
+	MaskWord invert;
+	SsocrMask &mask;
+public:
+	BinarizeTask(const unsigned char *ptr, int pitch, int w, int lum_limit, bool black_on_white, SsocrMask &mask):
+		ptr(ptr), pitch(pitch), w(w), lum_limit(lum_limit), invert(black_on_white?0:~(MaskWord)0), mask(mask) {}
+	void Run(int strip, int y1, int y2)
+	{
+		for (int y=y1; y<y2; y++) {
+			const Sample *row=(const Sample*)(ptr+pitch*y);
+			MaskWord *mask_row=mask.GetRow(y);
+			int x=binarize_words(row, w, lum_limit, invert, mask_row);
+			MaskWord word=0;
+			for (; x<w; x++) {
+				word|=(MaskWord)(row[x]<lum_limit)<<(x%MASK_WORD_BITS);
+				if (x%MASK_WORD_BITS==MASK_WORD_BITS-1||x==w-1) {
+					mask_row[x/MASK_WORD_BITS]=(word^invert)&(x==w-1?((MaskWord)2<<(x%MASK_WORD_BITS))-1:~(MaskWord)0);
+					word=0;
+				}
+			}
+		}
+	}
+};
+
+/* local threshold: vertical window sums of every column are updated incrementally row by row and their prefix sums
+* form a row of integral image, so the cost per pixel doesn't depend on window size,
+* every strip starts with the sums of the window around its first row,
+* sums are 32-bit for 8-bit samples and doubles for 16-bit ones, squared prefix of 8-bit samples is 32-bit
+* if squared sum of the window fits 32 bits (difference of wrapped prefixes is still exact) and 64-bit otherwise */
+template <class Sample, class Sum, class SqSum>
+class LocalThresholdTask: public SsocrStripTask {
+private:
+	const unsigned char *ptr;
+	int pitch, w, h;
+	int r; /* window radius */
+	float fk;
+	float max_lum; /* constants given for 8-bit luminance are scaled to the bit depth */
+	float inv_sauvola_r; /* reciprocal of dynamic range of standard deviation */
+	float niblack_contrast;
+	SsocrThreshold thresh_flags;
+	bool black_on_white;
+	SsocrMask &mask;
+
+	bool decide(float lum, float mean, float stddev) const
+	{
+		if (thresh_flags==SAUVOLA_THRESHOLD) {
+			/* Sauvola threshold for light foreground is computed on inverted image */
+			if (black_on_white)
+				return lum<mean*(1.0f+fk*(stddev*inv_sauvola_r-1.0f));
+			else
+				return max_lum-lum<(max_lum-mean)*(1.0f+fk*(stddev*inv_sauvola_r-1.0f));
+		} else {
+			if (black_on_white)
+				return lum<mean-fk*stddev&&lum<mean-niblack_contrast;
+			else
+				return lum>mean+fk*stddev&&lum>mean+niblack_contrast;
+		}
+	}
+
+#ifdef SSOCR_SSE2
+	/* same decision as above for 4 pixels with the window inside of the row, starts at x that is multiple of 4,
+	* bits are added to the mask word, returns first pixel that is left */
+	/* squared sums of 4 windows: unsigned 32-bit is converted by 16-bit halves (both exact, rounded once by the addition) */
+	static __m128 window_sq(const unsigned int *int_sq, int x, int r)
+	{
+		__m128i sq=_mm_sub_epi32(_mm_loadu_si128((const __m128i*)(int_sq+x+r+1)), _mm_loadu_si128((const __m128i*)(int_sq+x-r)));
+		return _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(sq, 16)), _mm_set1_ps(65536.0f)), _mm_cvtepi32_ps(_mm_and_si128(sq, _mm_set1_epi32(0xFFFF))));
+	}
+	/* SSE2 has no 64-bit integer to float conversion, window sums are converted one by one */
+	static __m128 window_sq(const unsigned long long *int_sq, int x, int r)
+	{
+		return _mm_setr_ps((float)(int_sq[x+r+1]-int_sq[x-r]), (float)(int_sq[x+r+2]-int_sq[x-r+1]), (float)(int_sq[x+r+3]-int_sq[x-r+2]), (float)(int_sq[x+r+4]-int_sq[x-r+3]));
+	}
+	template <class IntSqSum>
+	int decide_simd(const unsigned char *row, const unsigned int *int_sum, const IntSqSum *int_sq, int x, int end, float inv_n, MaskWord *mask_row, MaskWord &word) const
+	{
+		__m128 inv=_mm_set1_ps(inv_n), zero=_mm_setzero_ps(), one=_mm_set1_ps(1.0f), k=_mm_set1_ps(fk);
+		__m128 inv_r=_mm_set1_ps(inv_sauvola_r), lum_max=_mm_set1_ps(max_lum), contrast=_mm_set1_ps(niblack_contrast);
+		__m128i zero_i=_mm_setzero_si128();
+		for (; x+4<=end; x+=4) {
+			__m128i sum=_mm_sub_epi32(_mm_loadu_si128((const __m128i*)(int_sum+x+r+1)), _mm_loadu_si128((const __m128i*)(int_sum+x-r)));
+			__m128 sq_f=window_sq(int_sq, x, r);
+			__m128 mean=_mm_mul_ps(_mm_cvtepi32_ps(sum), inv);
+			__m128 var=_mm_sub_ps(_mm_mul_ps(sq_f, inv), _mm_mul_ps(mean, mean));
+			__m128 stddev=_mm_sqrt_ps(_mm_max_ps(var, zero));
+			int lum4;
+			memcpy(&lum4, row+x, 4);
+			__m128 lum=_mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(lum4), zero_i), zero_i));
+			__m128 set;
+			if (thresh_flags==SAUVOLA_THRESHOLD) {
+				__m128 factor=_mm_add_ps(one, _mm_mul_ps(k, _mm_sub_ps(_mm_mul_ps(stddev, inv_r), one)));
+				if (black_on_white)
+					set=_mm_cmplt_ps(lum, _mm_mul_ps(mean, factor));
+				else
+					set=_mm_cmplt_ps(_mm_sub_ps(lum_max, lum), _mm_mul_ps(_mm_sub_ps(lum_max, mean), factor));
+			} else {
+				__m128 dev=_mm_mul_ps(k, stddev);
+				if (black_on_white)
+					set=_mm_and_ps(_mm_cmplt_ps(lum, _mm_sub_ps(mean, dev)), _mm_cmplt_ps(lum, _mm_sub_ps(mean, contrast)));
+				else
+					set=_mm_and_ps(_mm_cmpgt_ps(lum, _mm_add_ps(mean, dev)), _mm_cmpgt_ps(lum, _mm_add_ps(mean, contrast)));
+			}
+			word|=(MaskWord)(unsigned int)_mm_movemask_ps(set)<<(x%MASK_WORD_BITS);
+			if ((x+3)%MASK_WORD_BITS==MASK_WORD_BITS-1||x+3==w-1) {
+				mask_row[x/MASK_WORD_BITS]=word;
+				word=0;
+			}
+		}
+		return x;
+	}
+#endif
+	template <class RowSample, class IntSum, class IntSqSum>
+	int decide_simd(const RowSample *row, const IntSum *int_sum, const IntSqSum *int_sq, int x, int end, float inv_n, MaskWord *mask_row, MaskWord &word) const
+	{
+		return x;
+	}
+public:
+	LocalThresholdTask(const unsigned char *ptr, int pitch, int w, int h, int max_lum, double k, SsocrThreshold thresh_flags, bool black_on_white, SsocrMask &mask):
+		ptr(ptr), pitch(pitch), w(w), h(h), r(GetRadius(w, h)), fk((float)(k/100.0)), max_lum((float)max_lum),
+		inv_sauvola_r((float)(MAXRGB/(SAUVOLA_R*max_lum))), niblack_contrast((float)(NIBLACK_MIN_CONTRAST*max_lum/MAXRGB)), thresh_flags(thresh_flags), black_on_white(black_on_white), mask(mask)
+	{}
+	static int GetRadius(int w, int h)
+	{
+		int r=(w<h?w:h)/LOCAL_WINDOW_DIV/2;
+		return r<LOCAL_MIN_RADIUS?LOCAL_MIN_RADIUS:r;
+	}
+	void Run(int strip, int y1, int y2)
+	{
+		std::vector<Sum> col_sum(w), col_sq(w); /* column sums over window rows */
+		std::vector<Sum> int_sum(w+1); /* row of integral image */
+		std::vector<SqSum> int_sq(w+1); /* row of squared integral image */
+
+		for (int yi=(y1-r>0?y1-r:0); yi<=y1+r&&yi<h; yi++)
+			accumulate_row((const Sample*)(ptr+pitch*yi), w, 1, &col_sum[0], &col_sq[0]);
+
+		for (int y=y1; y<y2; y++) {
+			if (y>y1&&y-r-1>=0&&y+r<h)
+				slide_rows((const Sample*)(ptr+pitch*(y+r)), (const Sample*)(ptr+pitch*(y-r-1)), w, &col_sum[0], &col_sq[0]);
+			else if (y>y1&&y-r-1>=0)
+				accumulate_row((const Sample*)(ptr+pitch*(y-r-1)), w, -1, &col_sum[0], &col_sq[0]);
+			else if (y>y1&&y+r<h)
+				accumulate_row((const Sample*)(ptr+pitch*(y+r)), w, 1, &col_sum[0], &col_sq[0]);
+			int rows=(y+r<h?y+r:h-1)-(y-r>0?y-r:0)+1;
+
+			int_sum[0]=0;
+			int_sq[0]=0;
+			for (int x=0; x<w; x++) {
+				int_sum[x+1]=int_sum[x]+col_sum[x];
+				int_sq[x+1]=int_sq[x]+col_sq[x];
+			}
+
+			const Sample *row=(const Sample*)(ptr+pitch*y);
+			MaskWord *mask_row=mask.GetRow(y);
+			MaskWord word=0;
+			/* window of pixels [r,w-r-1] doesn't cross left and right edges, so it has the same size */
+			int simd_start=(r+3)/4*4;
+			float inv_full=1.0f/(float)((2*r+1)*rows);
+			for (int x=0; x<w; x++) {
+				if (x==simd_start&&(x=decide_simd(row, &int_sum[0], &int_sq[0], x, w-r, inv_full, mask_row, word))>=w)
+					break;
+				int x1=x-r>0?x-r:0;
+				int x2=x+r<w?x+r+1:w;
+				float inv_n=1.0f/(float)((x2-x1)*rows);
+				float mean=(float)(Sum)(int_sum[x2]-int_sum[x1])*inv_n;
+				float var=(float)(SqSum)(int_sq[x2]-int_sq[x1])*inv_n-mean*mean;
+				float stddev=sqrtf(var>0.0f?var:0.0f);
+
+				word|=(MaskWord)decide(row[x], mean, stddev)<<(x%MASK_WORD_BITS);
+				if (x%MASK_WORD_BITS==MASK_WORD_BITS-1||x==w-1) {
+					mask_row[x/MASK_WORD_BITS]=word;
+					word=0;
+				}
+			}
+		}
+	}
+};
+
+/* average luminance of scale x scale blocks scaled down to 8 bits */
+template <class Sample>
+static void downsample_blocks(const unsigned char *ptr, int pitch, int bit_depth, int scale, int w, int h, unsigned char *dst)
+{
+	std::vector<unsigned int> sum(w);
+	unsigned int area=scale*scale;
+
+	for (int j=0; j<h; j++) {
+		std::fill(sum.begin(), sum.end(), 0);
+		for (int k=0; k<scale; k++) {
+			const Sample *row=(const Sample*)(ptr+pitch*(j*scale+k));
+			for (int i=0; i<w; i++)
+				for (int l=0; l<scale; l++)
+					sum[i]+=*row++;
+		}
+		for (int i=0; i<w; i++)
+			*dst++=(unsigned char)(((sum[i]+area/2)/area)>>(bit_depth-8));
+	}
+}
+
 /* clip value thus that it is in the given interval [min,max] */
 int SsocrImg::clip(int value, int min, int max) const
 {
@@ -29,7 +439,9 @@ int SsocrImg::clip(int value, int min, int max) const
 /* check if a pixel is set regarding current foreground/background colors */
 bool SsocrImg::is_pixel_set(int x, int y, double treshold, bool black_on_white) const
 {
-	if (black_on_white==(QueryYuvLuma(x, y)<treshold/100.0*MAXRGB))
+	if (mask)
+		return x>=0&&y>=0&&x<img_width&&y<img_height&&mask->Get(x, y);
+	if (black_on_white==(QueryYuvLuma(x, y)<treshold/100.0*GetMaxLuma()))
 		return true;
 	else
 		return false;
@@ -42,7 +454,8 @@ double SsocrImg::adapt_threshold(double thresh, int x, int y, int w, int h, Ssoc
 		case ABSOLUTE_THRESHOLD:
 			return thresh;
 			break;
-		case ADAPTIVE_THRESHOLD:
+		case ADAPTIVE_THRESHOLD: /* fallthrough */
+		case TEMPORAL_THRESHOLD: /* temporal state is kept by Ssocr, single frame is thresholded adaptively */
 			return get_threshold(thresh/100.0, x, y, w, h);
 			break;
 		case ITERATIVE_THRESHOLD:
@@ -57,10 +470,17 @@ double SsocrImg::adapt_threshold(double thresh, int x, int y, int w, int h, Ssoc
 /* compute dynamic threshold value from the rectangle (x,y),(x+w,y+h) of source_image */
 double SsocrImg::get_threshold(double fraction, int x, int y, int w, int h) const
 {
-	int xi, yi; /* iteration variables */
-	int lum; /* luminance of pixel */
-	double minval=(double)MAXRGB, maxval=0.0;
+	double minval, maxval;
+
+	/* find the threshold value to differentiate between dark and light */
+	get_range(1, x, y, w, h, minval, maxval);
+
+	return (minval+fraction*(maxval-minval))*100/GetMaxLuma();
+}
 
+/* get minimum and maximum luminance of every step-th row and column of the rectangle (x,y),(x+w,y+h) */
+void SsocrImg::get_range(int step, int x, int y, int w, int h, double &minval, double &maxval) const
+{
 	/* special value -1 for width or height means image width/height */
 	if (w==-1) w=img_width;
 	if (h==-1) h=img_height;	
@@ -71,35 +491,62 @@ double SsocrImg::get_threshold(double fraction, int x, int y, int w, int h) cons
 	if (x<0) x=0;
 	if (y<0) y=0;
 
-	/* find the threshold value to differentiate between dark and light */
-	for (xi=0; (xi<w)&&(xi<img_width); xi++) {
-		for (yi=0; (yi<h)&&(yi<img_height); yi++) {
-			lum=QueryYuvLuma(x+xi, y+yi);
-			if (lum<minval) minval=lum;
-			if (lum>maxval) maxval=lum;
-		}
+	/* strips are made of sampled rows, their ranges are merged */
+	int rows=((h<img_height?h:img_height)+step-1)/step;
+	int strips=SsocrStripPool::GetStripCount(pool, rows);
+	std::vector<int> minlum, maxlum;
+	if (yuv_data[0].bit_depth>8) {
+		RangeTask<unsigned short> task(yuv_data[0].ptr+yuv_data[0].pitch*y+x*2, yuv_data[0].pitch*step, w<img_width?w:img_width, step, GetMaxLuma(), strips);
+		SsocrStripPool::Run(pool, task, rows, "range strip");
+		minlum.swap(task.minlum);
+		maxlum.swap(task.maxlum);
+	} else {
+		RangeTask<unsigned char> task(yuv_data[0].ptr+yuv_data[0].pitch*y+x, yuv_data[0].pitch*step, w<img_width?w:img_width, step, GetMaxLuma(), strips);
+		SsocrStripPool::Run(pool, task, rows, "range strip");
+		minlum.swap(task.minlum);
+		maxlum.swap(task.maxlum);
 	}
+	minval=*std::min_element(minlum.begin(), minlum.end());
+	maxval=*std::max_element(maxlum.begin(), maxlum.end());
+}
 
-	return (minval+fraction*(maxval-minval))*100/MAXRGB;
+/* merge histograms of the strips */
+template <class Sample>
+static void merge_histograms(const HistogramTask<Sample> &task, std::vector<unsigned int> &histogram)
+{
+	histogram.assign(task.bins, 0);
+	for (size_t i=0; i<task.histograms.size(); i++)
+		histogram[i%task.bins]+=task.histograms[i];
+}
+
+/* get luminance histogram of the rectangle (x,y),(x+w,y+h), rectangle should lie inside of the image */
+void SsocrImg::get_histogram(int x, int y, int w, int h, std::vector<unsigned int> &histogram) const
+{
+	int strips=SsocrStripPool::GetStripCount(pool, h);
+	if (yuv_data[0].bit_depth>8) {
+		HistogramTask<unsigned short> task(yuv_data[0].ptr+yuv_data[0].pitch*y+x*2, yuv_data[0].pitch, w, GetMaxLuma(), strips);
+		SsocrStripPool::Run(pool, task, h, "histogram strip");
+		merge_histograms(task, histogram);
+	} else {
+		HistogramTask<unsigned char> task(yuv_data[0].ptr+yuv_data[0].pitch*y+x, yuv_data[0].pitch, w, GetMaxLuma(), strips);
+		SsocrStripPool::Run(pool, task, h, "histogram strip");
+		merge_histograms(task, histogram);
+	}
 }
 
 /* determine threshold by an iterative method */
 double SsocrImg::iterative_threshold(double thresh, int x, int y, int w, int h) const
 {
-	int xi, yi; /* iteration variables */
 	int lum; /* luminance of pixel */
+	std::vector<unsigned int> histogram; /* number of pixels of every luminance */
 	unsigned int size_white, size_black; /* size of black and white groups */
-	unsigned long int sum_white, sum_black; /* sum of black and white groups */
+	unsigned long long sum_white, sum_black; /* sum of black and white groups, 16-bit luminance of big image doesn't fit 32 bits */
 	unsigned int avg_white, avg_black; /* average values of black and white */
 	double old_thresh; /* old threshold computed by last iteration step */
 	double new_thresh; /* new threshold computed by current iteration step */
 	int thresh_lum; /* luminance value of threshold */
-
-	/* adjusting threshold to image */
-	thresh=get_threshold(thresh/100.0, x, y, w, h);
-
-	/* normalize threshold (was given as a percentage) */
-	new_thresh=thresh/100.0;
+	int max_lum=GetMaxLuma();
+	double minval=max_lum, maxval=0;
 
 	/* special value -1 for width or height means image width/height */
 	if (w==-1) w=img_width;
@@ -111,40 +558,116 @@ double SsocrImg::iterative_threshold(double thresh, int x, int y, int w, int h)
 	if (x<0) x=0;
 	if (y<0) y=0;
 
+	/* image is scanned once: range and sums of both groups on every iteration are found from histogram */
+	get_histogram(x, y, w<img_width?w:img_width, h<img_height?h:img_height, histogram);
+	unsigned int size_total=0;
+	unsigned long long sum_total=0;
+	for (lum=0; lum<=max_lum; lum++)
+		if (histogram[lum]) {
+			if (minval>lum) minval=lum;
+			maxval=lum;
+			size_total+=histogram[lum];
+			sum_total+=(unsigned long long)histogram[lum]*lum;
+		}
+
+	/* adjusting threshold to image (same as get_threshold) */
+	thresh=(minval+thresh/100.0*(maxval-minval))*100/max_lum;
+
+	/* normalize threshold (was given as a percentage) */
+	new_thresh=thresh/100.0;
+
 	/* find the threshold value to differentiate between dark and light */
 	do {
-		thresh_lum=(int)(MAXRGB*new_thresh);
+		thresh_lum=(int)(max_lum*new_thresh);
 		old_thresh=new_thresh;
-		size_black=sum_black=size_white=sum_white = 0;
-		for(xi=0; (xi<w)&&(xi<img_width); xi++) {
-			for(yi=0; (yi<h)&&(yi<img_height); yi++) {
-				lum=QueryYuvLuma(xi, yi);
-				if (lum<=thresh_lum) {
-					size_black++;
-					sum_black+=lum;
-				} else {
-					size_white++;
-					sum_white+=lum;
-				}
-			}
+		size_black=sum_black=0;
+		for (lum=0; lum<=thresh_lum&&lum<=max_lum; lum++) {
+			size_black+=histogram[lum];
+			sum_black+=(unsigned long long)histogram[lum]*lum;
 		}
+		size_white=size_total-size_black;
+		sum_white=sum_total-sum_black;
 		if (!size_white) 
 			return thresh;
 		if (!size_black)
 			return thresh;
-		avg_white=sum_white/size_white;
-		avg_black=sum_black/size_black;
-		new_thresh=(avg_white+avg_black)/(2.0*MAXRGB);
+		avg_white=(unsigned int)(sum_white/size_white);
+		avg_black=(unsigned int)(sum_black/size_black);
+		new_thresh=(avg_white+avg_black)/(2.0*max_lum);
 	} while (fabs(new_thresh-old_thresh)>EPSILON);
 
 	return new_thresh*100;
 }
 
+/* binarize image to mask with global threshold (same decision as is_pixel_set) */
+void SsocrImg::binarize(SsocrMask &mask, double threshold, bool black_on_white) const
+{
+	/* integer luminance is below threshold if it's below threshold rounded up */
+	int max_lum=GetMaxLuma();
+	double limit=ceil(threshold/100.0*max_lum);
+	int lum_limit=limit<0.0?0:(limit>max_lum+1?max_lum+1:(int)limit);
+
+	mask.Resize(img_width, img_height);
+	if (yuv_data[0].bit_depth>8) {
+		BinarizeTask<unsigned short> task(yuv_data[0].ptr, yuv_data[0].pitch, img_width, lum_limit, black_on_white, mask);
+		SsocrStripPool::Run(pool, task, img_height, "binarize strip");
+	} else {
+		BinarizeTask<unsigned char> task(yuv_data[0].ptr, yuv_data[0].pitch, img_width, lum_limit, black_on_white, mask);
+		SsocrStripPool::Run(pool, task, img_height, "binarize strip");
+	}
+}
+
+/* binarize image to mask with local threshold computed from mean and standard deviation of the window around every pixel */
+void SsocrImg::local_threshold(SsocrMask &mask, double k, SsocrThreshold thresh_flags, bool black_on_white) const
+{
+	mask.Resize(img_width, img_height);
+	if (!img_width||!img_height)
+		return;
+
+	int side=2*LocalThresholdTask<unsigned char, unsigned int, unsigned int>::GetRadius(img_width, img_height)+1;
+	if (yuv_data[0].bit_depth>8) {
+		LocalThresholdTask<unsigned short, double, double> task(yuv_data[0].ptr, yuv_data[0].pitch, img_width, img_height, GetMaxLuma(), k, thresh_flags, black_on_white, mask);
+		SsocrStripPool::Run(pool, task, img_height, "local threshold strip");
+	} else if ((double)side*side*MAXRGB*MAXRGB<4294967296.0) {
+		LocalThresholdTask<unsigned char, unsigned int, unsigned int> task(yuv_data[0].ptr, yuv_data[0].pitch, img_width, img_height, GetMaxLuma(), k, thresh_flags, black_on_white, mask);
+		SsocrStripPool::Run(pool, task, img_height, "local threshold strip");
+	} else {
+		LocalThresholdTask<unsigned char, unsigned int, unsigned long long> task(yuv_data[0].ptr, yuv_data[0].pitch, img_width, img_height, GetMaxLuma(), k, thresh_flags, black_on_white, mask);
+		SsocrStripPool::Run(pool, task, img_height, "local threshold strip");
+	}
+}
+
+/* average 8-bit luminance of scale x scale blocks of the rectangle (x,y),(x+w,y+h) given in blocks to w*h buffer, blocks should lie inside of the image */
+void SsocrImg::downsample(int scale, int x, int y, int w, int h, unsigned char *dst) const
+{
+	if (yuv_data[0].bit_depth>8)
+		downsample_blocks<unsigned short>(yuv_data[0].ptr+yuv_data[0].pitch*y*scale+x*scale*2, yuv_data[0].pitch, yuv_data[0].bit_depth, scale, w, h, dst);
+	else
+		downsample_blocks<unsigned char>(yuv_data[0].ptr+yuv_data[0].pitch*y*scale+x*scale, yuv_data[0].pitch, yuv_data[0].bit_depth, scale, w, h, dst);
+}
+
+/* make is_pixel_set use the mask of the same size instead of threshold (NULL to disable) */
+void SsocrImg::set_mask(const SsocrMask *mask)
+{
+	this->mask=mask;
+}
+
+const SsocrMask *SsocrImg::get_mask() const
+{
+	return mask;
+}
+
+/* split statistics and binarization in strips processed by the pool (NULL to process them in calling thread) */
+void SsocrImg::set_pool(SsocrStripPool *pool)
+{
+	this->pool=pool;
+}
+
 /* get minimum lum value */
 double SsocrImg::get_minval(int x, int y, int w, int h) const
 {
 	int xi, yi; /* iteration variables */
-	int minval=MAXRGB;
+	int minval=GetMaxLuma();
 	int lum=0;
 
 	/* special value -1 for width or height means image width/height */
@@ -160,7 +683,7 @@ double SsocrImg::get_minval(int x, int y, int w, int h) const
 	/* find the minimum value in the image */
 	for(xi=0; (xi<w)&&(xi<img_width); xi++) {
 		for(yi=0; (yi<h)&&(yi<img_height); yi++) {
-			lum=clip(QueryYuvLuma(xi, yi), 0, 255);
+			lum=clip(QueryYuvLuma(xi, yi), 0, GetMaxLuma());
 			if (lum<minval) minval=lum;
 		}
 	}
@@ -188,7 +711,7 @@ double SsocrImg::get_maxval(int x, int y, int w, int h) const
 	/* find the minimum value in the image */
 	for(xi=0; (xi<w)&&(xi<img_width); xi++) {
 		for(yi=0; (yi<h)&&(yi<img_height); yi++) {
-			lum=clip(QueryYuvLuma(xi, yi), 0, 255);
+			lum=clip(QueryYuvLuma(xi, yi), 0, GetMaxLuma());
 			if (lum>maxval) maxval=lum;
 		}
 	}
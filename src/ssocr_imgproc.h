@@ -15,11 +15,17 @@
 #ifndef SSOCR_IMGPROC_H
 #define SSOCR_IMGPROC_H
 
+#include <vector>
 #include "ssocr_defines.h"
 #include "yuvimg.h"
+#include "ssocr_mask.h"
+#include "ssocr_strips.h"
 
 class SsocrImg: public YuvImg {
 private: 
+	const SsocrMask *mask; /* if set - is_pixel_set returns mask pixels */
+	SsocrStripPool *pool; /* if set - statistics and binarization are computed in parallel strips */
+
 	/* clip value thus that it is in the given interval [min,max] */
 	int clip(int value, int min, int max) const;
 	/* get minimum lum value */
@@ -28,14 +34,29 @@ private:
 	double get_maxval(int x, int y, int w, int h) const;
 	/* compute dynamic threshold value from the rectangle (x,y),(x+w,y+h) of source_image */
 	double get_threshold(double fraction, int x, int y, int w, int h) const;
+	/* get luminance histogram of the rectangle (x,y),(x+w,y+h), rectangle should lie inside of the image */
+	void get_histogram(int x, int y, int w, int h, std::vector<unsigned int> &histogram) const;
 	/* determine threshold by an iterative method */
 	double iterative_threshold(double thresh, int x, int y, int w, int h) const;
 public:
-	SsocrImg(const PVideoFrame &src, const VideoInfo &vi);
+	SsocrImg(const PlaneData *planes, int width, int height, bool read_only);
 	/* check if a pixel is set regarding current foreground/background colors */
 	bool is_pixel_set(int x, int y, double threshold, bool black_on_white) const;
 	/* adapt threshold to image values */
 	double adapt_threshold(double thresh, int x, int y, int w, int h, SsocrThreshold thresh_flags) const;
+	/* get minimum and maximum luminance of every step-th row and column of the rectangle (x,y),(x+w,y+h) */
+	void get_range(int step, int x, int y, int w, int h, double &minval, double &maxval) const;
+	/* binarize image to mask with global threshold (same decision as is_pixel_set) */
+	void binarize(SsocrMask &mask, double threshold, bool black_on_white) const;
+	/* binarize image to mask with local (Sauvola or Niblack) threshold, k is given as a percentage */
+	void local_threshold(SsocrMask &mask, double k, SsocrThreshold thresh_flags, bool black_on_white) const;
+	/* average luminance of scale x scale blocks of the rectangle (x,y),(x+w,y+h) given in blocks to w*h buffer, blocks should lie inside of the image */
+	void downsample(int scale, int x, int y, int w, int h, unsigned char *dst) const;
+	/* make is_pixel_set use the mask of the same size instead of threshold (NULL to disable) */
+	void set_mask(const SsocrMask *mask);
+	const SsocrMask *get_mask() const;
+	/* split statistics and binarization in strips processed by the pool (NULL to process them in calling thread) */
+	void set_pool(SsocrStripPool *pool);
 };
 
 #endif //SSOCR_IMGPROC_H
\ No newline at end of file
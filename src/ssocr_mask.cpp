@@ -0,0 +1,132 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ssocr_mask.h"
+
+SsocrMask::SsocrMask():
+	width(0), height(0), row_words(0), bits()
+{}
+
+void SsocrMask::Resize(int width, int height)
+{
+	this->width=width;
+	this->height=height;
+	row_words=(width+MASK_WORD_BITS-1)/MASK_WORD_BITS;
+	if ((int)bits.size()<row_words*height)
+		bits.resize(row_words*height);
+}
+
+/* valid bits of the last word of every row */
+MaskWord SsocrMask::GetLastWordMask() const
+{
+	return width%MASK_WORD_BITS?((MaskWord)1<<width%MASK_WORD_BITS)-1:~(MaskWord)0;
+}
+
+/* horizontal pass: every pixel is combined with its left and right neighbours, 64 pixels at a time,
+* neighbours across word boundary are carried from adjacent words, pixels outside of the row are
+* treated as neutral element (foreground for erosion, background for dilation) */
+void SsocrMask::ShiftRows(SsocrMask &dst, bool erode) const
+{
+	MaskWord outside=erode?~(MaskWord)0:0;
+	MaskWord last_word_mask=GetLastWordMask();
+
+	for (int y=0; y<height; y++) {
+		const MaskWord *src_row=GetRow(y);
+		MaskWord *dst_row=dst.GetRow(y);
+		MaskWord prev=outside;
+		for (int i=0; i<row_words; i++) {
+			MaskWord cur=src_row[i];
+			MaskWord next;
+			if (i+1<row_words) {
+				next=src_row[i+1];
+			} else {
+				next=outside;
+				cur|=outside&~last_word_mask;
+			}
+			MaskWord left=cur<<1|prev>>(MASK_WORD_BITS-1);
+			MaskWord right=cur>>1|next<<(MASK_WORD_BITS-1);
+			dst_row[i]=erode?cur&left&right:cur|left|right;
+			prev=cur;
+		}
+		dst_row[row_words-1]&=last_word_mask;
+	}
+}
+
+/* vertical pass: every row is combined with rows above and below it */
+void SsocrMask::CombineRows(SsocrMask &dst, bool erode) const
+{
+	for (int y=0; y<height; y++) {
+		const MaskWord *cur=GetRow(y);
+		const MaskWord *up=y>0?GetRow(y-1):cur;
+		const MaskWord *down=y+1<height?GetRow(y+1):cur;
+		MaskWord *dst_row=dst.GetRow(y);
+		if (erode)
+			for (int i=0; i<row_words; i++)
+				dst_row[i]=up[i]&cur[i]&down[i];
+		else
+			for (int i=0; i<row_words; i++)
+				dst_row[i]=up[i]|cur[i]|down[i];
+	}
+}
+
+void SsocrMask::Erode(SsocrMask &scratch)
+{
+	scratch.Resize(width, height);
+	ShiftRows(scratch, true);
+	scratch.CombineRows(*this, true);
+}
+
+void SsocrMask::Dilate(SsocrMask &scratch)
+{
+	scratch.Resize(width, height);
+	ShiftRows(scratch, false);
+	scratch.CombineRows(*this, false);
+}
+
+/* removes foreground speckles smaller than 3x3 */
+void SsocrMask::Open(SsocrMask &scratch)
+{
+	Erode(scratch);
+	Dilate(scratch);
+}
+
+/* fills background gaps smaller than 3x3 */
+void SsocrMask::Close(SsocrMask &scratch)
+{
+	Dilate(scratch);
+	Erode(scratch);
+}
+
+void SsocrMask::Apply(const std::string &ops, SsocrMask &scratch)
+{
+	for (std::string::const_iterator it=ops.begin(); it!=ops.end(); it++)
+		switch (*it) {
+			case 'e':
+				Erode(scratch);
+				break;
+			case 'd':
+				Dilate(scratch);
+				break;
+			case 'o':
+				Open(scratch);
+				break;
+			case 'c':
+				Close(scratch);
+				break;
+		}
+}
+
+bool SsocrMask::CheckOps(const std::string &ops)
+{
+	return ops.find_first_not_of("edoc")==std::string::npos;
+}
\ No newline at end of file
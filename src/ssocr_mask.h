@@ -0,0 +1,58 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SSOCR_MASK_H
+#define SSOCR_MASK_H
+
+#include <string>
+#include <vector>
+
+typedef unsigned long long MaskWord;
+
+/* number of pixels in single mask word */
+#define MASK_WORD_BITS 64
+
+//Binarized image packed to 64 pixels per word, set bit means foreground (digit) pixel
+//Pixel x of the row is bit x%64 of word x/64, bits past the right edge are always zero
+class SsocrMask {
+private:
+	int width;
+	int height;
+	int row_words;
+	std::vector<MaskWord> bits;
+
+	void ShiftRows(SsocrMask &dst, bool erode) const;
+	void CombineRows(SsocrMask &dst, bool erode) const;
+	MaskWord GetLastWordMask() const;
+public:
+	SsocrMask();
+	//Buffer is reused if mask isn't getting bigger, contents are undefined after resize
+	void Resize(int width, int height);
+	int GetWidth() const { return width; }
+	int GetHeight() const { return height; }
+	int GetRowWords() const { return row_words; }
+	MaskWord *GetRow(int y) { return &bits[row_words*y]; }
+	const MaskWord *GetRow(int y) const { return &bits[row_words*y]; }
+	bool Get(int x, int y) const { return (bits[row_words*y+x/MASK_WORD_BITS]>>(x%MASK_WORD_BITS))&1; }
+	//Morphological operations with 3x3 square, pixels outside of the mask don't affect the result
+	//Scratch mask is used as intermediate buffer
+	void Erode(SsocrMask &scratch);
+	void Dilate(SsocrMask &scratch);
+	void Open(SsocrMask &scratch);
+	void Close(SsocrMask &scratch);
+	//Applies sequence of operations: 'e' - erode, 'd' - dilate, 'o' - open, 'c' - close
+	void Apply(const std::string &ops, SsocrMask &scratch);
+	static bool CheckOps(const std::string &ops);
+};
+
+#endif //SSOCR_MASK_H
\ No newline at end of file
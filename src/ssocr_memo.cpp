@@ -0,0 +1,88 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include "ssocr_memo.h"
+
+SsocrMemo::SsocrMemo(int num_frames):
+	num_frames(num_frames), pages((num_frames+PAGE_SIZE-1)/PAGE_SIZE, (Page*)NULL), ids(), results()
+{}
+
+SsocrMemo::~SsocrMemo()
+{
+	for (std::vector<Page*>::iterator it=pages.begin(); it!=pages.end(); it++)
+		delete *it;
+}
+
+bool SsocrMemo::Get(int frame, std::string &digits) const
+{
+	if (frame<0||frame>=num_frames)
+		return false;
+
+	const Page *page=pages[frame>>SSOCR_MEMO_PAGE_BITS];
+	int offset=frame&(PAGE_SIZE-1);
+	if (!page||!(page->processed[offset/32]&(1u<<offset%32)))
+		return false;
+
+	digits=results[page->ids[offset]];
+	return true;
+}
+
+void SsocrMemo::Set(int frame, const std::string &digits)
+{
+	if (frame<0||frame>=num_frames)
+		return;
+
+	Page *&page=pages[frame>>SSOCR_MEMO_PAGE_BITS];
+	if (!page) {
+		page=new Page;
+		memset(page->processed, 0, sizeof(page->processed));
+	}
+
+	std::map<std::string, unsigned int>::iterator id=ids.find(digits);
+	if (id==ids.end()) {
+		id=ids.insert(std::make_pair(digits, (unsigned int)results.size())).first;
+		results.push_back(digits);
+	}
+
+	int offset=frame&(PAGE_SIZE-1);
+	page->processed[offset/32]|=1u<<offset%32;
+	page->ids[offset]=id->second;
+}
+
+int SsocrMemo::GetNext(int frame) const
+{
+	if (frame<0)
+		frame=0;
+
+	while (frame<num_frames) {
+		const Page *page=pages[frame>>SSOCR_MEMO_PAGE_BITS];
+		int offset=frame&(PAGE_SIZE-1);
+		if (!page) {
+			frame+=PAGE_SIZE-offset;
+			continue;
+		}
+		//Skip whole words of unprocessed frames
+		unsigned int word=page->processed[offset/32]>>offset%32;
+		if (word) {
+			while (!(word&1)) {
+				word>>=1;
+				frame++;
+			}
+			return frame<num_frames?frame:-1;
+		}
+		frame+=32-offset%32;
+	}
+
+	return -1;
+}
\ No newline at end of file
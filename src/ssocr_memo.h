@@ -0,0 +1,51 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SSOCR_MEMO_H
+#define SSOCR_MEMO_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+/* frames per memo page (1<<SSOCR_MEMO_PAGE_BITS) */
+#define SSOCR_MEMO_PAGE_BITS 12
+
+//Recognition results of already processed frames of a clip
+//Frames are split to pages that are allocated on first write, so memory is spent only on visited parts of the clip
+//Every page holds bitset of processed frames and per-frame index into the dictionary of distinct results
+class SsocrMemo {
+private:
+	enum {PAGE_SIZE=1<<SSOCR_MEMO_PAGE_BITS, PAGE_WORDS=PAGE_SIZE/32};
+
+	struct Page {
+		unsigned int processed[PAGE_WORDS];
+		unsigned int ids[PAGE_SIZE];
+	};
+
+	int num_frames;
+	std::vector<Page*> pages;
+	std::map<std::string, unsigned int> ids;
+	std::vector<std::string> results;
+public:
+	SsocrMemo(int num_frames);
+	~SsocrMemo();
+	//Returns false if frame wasn't processed yet
+	bool Get(int frame, std::string &digits) const;
+	//Frames outside of the clip are ignored
+	void Set(int frame, const std::string &digits);
+	//Returns first processed frame starting from frame or -1 if there is none
+	int GetNext(int frame) const;
+};
+
+#endif //SSOCR_MEMO_H
\ No newline at end of file
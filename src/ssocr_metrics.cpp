@@ -0,0 +1,238 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <pthread.h>
+#endif
+#include "ssocr_metrics.h"
+
+static const char *counter_names[SsocrMetrics::COUNTER_COUNT][2]={
+	{"ssocr_frames_seen_total", "Frames requested from the filter."},
+	{"ssocr_frames_recognized_total", "Frames passed to recognition."},
+	{"ssocr_frames_unknown_total", "Recognized frames with at least one unrecognized digit."},
+	{"ssocr_frames_empty_total", "Recognized frames where no digits were found."},
+	{"ssocr_cache_hits_total", "Recognized frames binarized earlier by another recognizer on the same source."},
+	{"ssocr_disk_cache_hits_total", "Recognized frames taken from cache file."},
+	{"ssocr_glyph_lookups_total", "Digit cells looked up in glyph cache."},
+	{"ssocr_glyph_hits_total", "Digit cells decoded from glyph cache."}
+};
+
+#ifdef _WIN32
+struct SsocrMetrics::Publisher {
+	HANDLE thread;
+	HANDLE stop_event;
+
+	static DWORD WINAPI Proc(LPVOID arg)
+	{
+		SsocrMetrics *metrics=(SsocrMetrics*)arg;
+		while (WaitForSingleObject(metrics->publisher->stop_event, SSOCR_METRICS_PERIOD)==WAIT_TIMEOUT)
+			metrics->Publish();
+		return 0;
+	}
+};
+
+static inline void AtomicAdd(volatile long *value, long increment)
+{
+	InterlockedExchangeAdd(value, increment);
+}
+
+bool SsocrMetrics::Start()
+{
+	if (!Publish())
+		return false;
+	publisher->stop_event=CreateEvent(NULL, TRUE, FALSE, NULL);
+	publisher->thread=CreateThread(NULL, 0, Publisher::Proc, this, 0, NULL);
+	return true;
+}
+
+SsocrMetrics::~SsocrMetrics()
+{
+	if (publisher->thread) {
+		SetEvent(publisher->stop_event);
+		WaitForSingleObject(publisher->thread, INFINITE);
+		CloseHandle(publisher->thread);
+		CloseHandle(publisher->stop_event);
+		Publish();
+	}
+	delete publisher;
+}
+
+static bool RenameOver(const std::string &from, const std::string &to)
+{
+	return MoveFileEx(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING)!=0;
+}
+#else
+struct SsocrMetrics::Publisher {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t stop_cond;
+	bool running;
+	bool stop;
+
+	static void *Proc(void *arg)
+	{
+		SsocrMetrics *metrics=(SsocrMetrics*)arg;
+		Publisher *publisher=metrics->publisher;
+		pthread_mutex_lock(&publisher->lock);
+		while (!publisher->stop) {
+			struct timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_sec+=SSOCR_METRICS_PERIOD/1000;
+			deadline.tv_nsec+=(SSOCR_METRICS_PERIOD%1000)*1000000;
+			if (deadline.tv_nsec>=1000000000) {
+				deadline.tv_sec++;
+				deadline.tv_nsec-=1000000000;
+			}
+			while (!publisher->stop&&pthread_cond_timedwait(&publisher->stop_cond, &publisher->lock, &deadline)==0);
+			if (!publisher->stop) {
+				pthread_mutex_unlock(&publisher->lock);
+				metrics->Publish();
+				pthread_mutex_lock(&publisher->lock);
+			}
+		}
+		pthread_mutex_unlock(&publisher->lock);
+		return NULL;
+	}
+};
+
+static inline void AtomicAdd(volatile long *value, long increment)
+{
+	__sync_fetch_and_add(value, increment);
+}
+
+bool SsocrMetrics::Start()
+{
+	if (!Publish())
+		return false;
+	pthread_mutex_init(&publisher->lock, NULL);
+	pthread_cond_init(&publisher->stop_cond, NULL);
+	publisher->stop=false;
+	publisher->running=pthread_create(&publisher->thread, NULL, Publisher::Proc, this)==0;
+	return true;
+}
+
+SsocrMetrics::~SsocrMetrics()
+{
+	if (publisher->running) {
+		pthread_mutex_lock(&publisher->lock);
+		publisher->stop=true;
+		pthread_cond_signal(&publisher->stop_cond);
+		pthread_mutex_unlock(&publisher->lock);
+		pthread_join(publisher->thread, NULL);
+		pthread_cond_destroy(&publisher->stop_cond);
+		pthread_mutex_destroy(&publisher->lock);
+		Publish();
+	}
+	delete publisher;
+}
+
+static bool RenameOver(const std::string &from, const std::string &to)
+{
+	return rename(from.c_str(), to.c_str())==0;
+}
+#endif
+
+SsocrMetrics::SsocrMetrics(const std::string &path):
+	latency_sum(0), last_latency_sum(0), total_latency_sum(0.0), us_per_tick(1000000.0/SsocrTrace::GetTickFrequency()), path(path), publisher(new Publisher())
+{
+	for (int c=0; c<COUNTER_COUNT; c++)
+		counters[c]=0;
+	for (int b=0; b<SSOCR_METRICS_BUCKETS; b++)
+		buckets[b]=0;
+}
+
+void SsocrMetrics::Add(Counter counter, long count)
+{
+	AtomicAdd(&counters[counter], count);
+}
+
+void SsocrMetrics::AddLatency(SsocrTicks start)
+{
+	double us=(SsocrTrace::Now()-start)*us_per_tick;
+	int bucket=us>SSOCR_METRICS_BUCKET_BASE?(int)ceil(4.0*log(us/SSOCR_METRICS_BUCKET_BASE)/log(2.0)):0;
+	if (bucket>=SSOCR_METRICS_BUCKETS)
+		bucket=SSOCR_METRICS_BUCKETS-1;
+	AtomicAdd(&buckets[bucket], 1);
+	AtomicAdd((volatile long*)&latency_sum, (long)(us+0.5));
+}
+
+void SsocrMetrics::AddResult(const std::string &digits)
+{
+	Add(FRAMES_RECOGNIZED);
+	if (digits.empty())
+		Add(FRAMES_EMPTY);
+	else if (digits.find('?')!=std::string::npos)
+		Add(FRAMES_UNKNOWN);
+}
+
+//Returns upper bound of the bucket containing q-quantile, in seconds
+double SsocrMetrics::GetQuantile(const long *snapshot, long count, double q)
+{
+	long rank=(long)ceil(q*count);
+	long cumulative=0;
+	int b=0;
+	for (; b<SSOCR_METRICS_BUCKETS-1; b++) {
+		cumulative+=snapshot[b];
+		if (cumulative>=rank)
+			break;
+	}
+	return SSOCR_METRICS_BUCKET_BASE*pow(2.0, b/4.0)/1000000.0;
+}
+
+//Called only by one thread at a time: from Start, from publisher thread and from destructor after it's stopped
+bool SsocrMetrics::Publish()
+{
+	long snapshot[SSOCR_METRICS_BUCKETS];
+	long count=0;
+	for (int b=0; b<SSOCR_METRICS_BUCKETS; b++)
+		count+=snapshot[b]=buckets[b];
+	//Unsigned difference is correct across single wrap around of latency_sum
+	unsigned long cur_latency_sum=latency_sum;
+	total_latency_sum+=cur_latency_sum-last_latency_sum;
+	last_latency_sum=cur_latency_sum;
+
+	std::string tmp_path=path+".tmp";
+	std::ofstream out(tmp_path.c_str(), std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	for (int c=0; c<COUNTER_COUNT; c++) {
+		out<<"# HELP "<<counter_names[c][0]<<" "<<counter_names[c][1]<<"\n";
+		out<<"# TYPE "<<counter_names[c][0]<<" counter\n";
+		out<<counter_names[c][0]<<" "<<counters[c]<<"\n";
+	}
+	long recognized=counters[FRAMES_RECOGNIZED];
+	out<<"# HELP ssocr_unknown_ratio Fraction of recognized frames with at least one unrecognized digit.\n";
+	out<<"# TYPE ssocr_unknown_ratio gauge\n";
+	out<<"ssocr_unknown_ratio "<<(recognized?(double)counters[FRAMES_UNKNOWN]/recognized:0.0)<<"\n";
+	out<<"# HELP ssocr_glyph_hit_ratio Fraction of digit cells decoded from glyph cache.\n";
+	out<<"# TYPE ssocr_glyph_hit_ratio gauge\n";
+	out<<"ssocr_glyph_hit_ratio "<<(counters[GLYPH_LOOKUPS]?(double)counters[GLYPH_HITS]/counters[GLYPH_LOOKUPS]:0.0)<<"\n";
+	out<<"# HELP ssocr_recognition_latency_seconds Recognition time of single frame.\n";
+	out<<"# TYPE ssocr_recognition_latency_seconds summary\n";
+	if (count) {
+		out<<"ssocr_recognition_latency_seconds{quantile=\"0.5\"} "<<GetQuantile(snapshot, count, 0.5)<<"\n";
+		out<<"ssocr_recognition_latency_seconds{quantile=\"0.99\"} "<<GetQuantile(snapshot, count, 0.99)<<"\n";
+	}
+	out<<"ssocr_recognition_latency_seconds_sum "<<total_latency_sum/1000000.0<<"\n";
+	out<<"ssocr_recognition_latency_seconds_count "<<count<<"\n";
+	out.close();
+
+	return !out.fail()&&RenameOver(tmp_path, path);
+}
\ No newline at end of file
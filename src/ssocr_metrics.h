@@ -0,0 +1,59 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SSOCR_METRICS_H
+#define SSOCR_METRICS_H
+
+#include <string>
+#include "ssocr_trace.h"
+
+/* period of metrics file updates in mseconds */
+#define SSOCR_METRICS_PERIOD 5000
+
+/* latency histogram: bucket b holds latencies below SSOCR_METRICS_BUCKET_BASE*2^(b/4) useconds */
+#define SSOCR_METRICS_BUCKETS 64
+#define SSOCR_METRICS_BUCKET_BASE 10.0
+
+//Health counters of long-running recognition, periodically published to a text file in Prometheus exposition format
+//Counters are updated with atomic increments only, so Add/AddLatency can be called from GetFrame without locking
+//Background thread snapshots them and replaces the file atomically (temporary file is renamed over the old one)
+class SsocrMetrics {
+public:
+	enum Counter {FRAMES_SEEN, FRAMES_RECOGNIZED, FRAMES_UNKNOWN, FRAMES_EMPTY, CACHE_HITS, DISK_CACHE_HITS, GLYPH_LOOKUPS, GLYPH_HITS, COUNTER_COUNT};
+private:
+	volatile long counters[COUNTER_COUNT];
+	volatile long buckets[SSOCR_METRICS_BUCKETS];
+	volatile unsigned long latency_sum;		//Sum of latencies in useconds, wraps around
+	unsigned long last_latency_sum;			//Publisher's copy of latency_sum used to extend it to 64 bits
+	double total_latency_sum;
+	double us_per_tick;
+	std::string path;
+	struct Publisher;						//Native thread and stop signal
+	Publisher *publisher;
+
+	bool Publish();
+	static double GetQuantile(const long *snapshot, long count, double q);
+public:
+	SsocrMetrics(const std::string &path);
+	//Stops publisher thread and publishes final values
+	~SsocrMetrics();
+	//Publishes initial values and starts publisher thread, returns false if the file can't be written
+	bool Start();
+	void Add(Counter counter, long count=1);
+	//Records latency of recognition started at start (see SsocrTrace::Now)
+	void AddLatency(SsocrTicks start);
+	//Counts recognized frame as unknown if it contains '?' and empty if nothing was found
+	void AddResult(const std::string &digits);
+};
+
+#endif //SSOCR_METRICS_H
\ No newline at end of file
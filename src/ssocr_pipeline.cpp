@@ -0,0 +1,159 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <time.h>
+#include "ssocr_imgproc.h"
+#include "ssocr_pipeline.h"
+
+SsocrPipeline::SsocrPipeline(PipelineSource &source, PipelineSink &sink, const Ssocr &ssocr, const char* dec_sep, const char* neg_sign, int threads, int depth):
+	source(source), sink(sink), dec_sep(dec_sep), neg_sign(neg_sign), slots(depth>0?depth:1), states(slots.size(), FREE), workers(),
+	read_seq(0), recognize_seq(0), write_seq(0), eos(false), stats()
+{
+	if (threads<=0)
+		threads=1;
+	workers.reserve(threads);
+	for (int w=0; w<threads; w++)
+		workers.push_back(Worker(this, ssocr));
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&slot_freed, NULL);
+	pthread_cond_init(&slot_read, NULL);
+	pthread_cond_init(&slot_done, NULL);
+}
+
+SsocrPipeline::~SsocrPipeline()
+{
+	pthread_cond_destroy(&slot_done);
+	pthread_cond_destroy(&slot_read);
+	pthread_cond_destroy(&slot_freed);
+	pthread_mutex_destroy(&lock);
+}
+
+double SsocrPipeline::GetTime()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec+ts.tv_nsec/1000000000.0;
+}
+
+const SsocrPipeline::Stats &SsocrPipeline::Run()
+{
+	pthread_t reader;
+	double start=GetTime();
+
+	pthread_create(&reader, NULL, ReaderProc, this);
+	for (size_t w=0; w<workers.size(); w++)
+		pthread_create(&workers[w].thread, NULL, WorkerProc, &workers[w]);
+
+	//Calling thread is the ordering stage
+	for (;;) {
+		int slot=write_seq%slots.size();
+		double wait_start=GetTime();
+
+		pthread_mutex_lock(&lock);
+		while (states[slot]!=DONE&&!(eos&&write_seq==read_seq))
+			pthread_cond_wait(&slot_done, &lock);
+		if (states[slot]!=DONE) {
+			pthread_mutex_unlock(&lock);
+			break;
+		}
+		pthread_mutex_unlock(&lock);
+
+		double write_start=GetTime();
+		stats.write_stall+=write_start-wait_start;
+		sink.Write(slots[slot]);
+		source.Release(slot);
+		stats.write_time+=GetTime()-write_start;
+		stats.frames++;
+
+		pthread_mutex_lock(&lock);
+		states[slot]=FREE;
+		write_seq++;
+		pthread_cond_signal(&slot_freed);
+		pthread_mutex_unlock(&lock);
+	}
+
+	pthread_join(reader, NULL);
+	for (size_t w=0; w<workers.size(); w++) {
+		pthread_join(workers[w].thread, NULL);
+		stats.recognize_time+=workers[w].recognize_time;
+	}
+	stats.wall_time=GetTime()-start;
+
+	return stats;
+}
+
+void *SsocrPipeline::ReaderProc(void *arg)
+{
+	SsocrPipeline *pipeline=(SsocrPipeline*)arg;
+
+	for (;;) {
+		int slot=pipeline->read_seq%pipeline->slots.size();
+		double wait_start=GetTime();
+
+		//Bounded number of frames in flight: wait until writer frees the slot
+		pthread_mutex_lock(&pipeline->lock);
+		while (pipeline->states[slot]!=FREE)
+			pthread_cond_wait(&pipeline->slot_freed, &pipeline->lock);
+		pthread_mutex_unlock(&pipeline->lock);
+
+		double read_start=GetTime();
+		pipeline->stats.read_stall+=read_start-wait_start;
+		bool read=pipeline->source.Read(slot, pipeline->slots[slot]);
+		pipeline->stats.read_time+=GetTime()-read_start;
+
+		pthread_mutex_lock(&pipeline->lock);
+		if (!read) {
+			pipeline->eos=true;
+			pthread_cond_broadcast(&pipeline->slot_read);
+			pthread_cond_broadcast(&pipeline->slot_done);
+			pthread_mutex_unlock(&pipeline->lock);
+			break;
+		}
+		pipeline->states[slot]=READ;
+		pipeline->read_seq++;
+		pthread_cond_signal(&pipeline->slot_read);
+		pthread_mutex_unlock(&pipeline->lock);
+	}
+
+	return NULL;
+}
+
+void *SsocrPipeline::WorkerProc(void *arg)
+{
+	Worker *worker=(Worker*)arg;
+	SsocrPipeline *pipeline=worker->pipeline;
+
+	pthread_mutex_lock(&pipeline->lock);
+	for (;;) {
+		while (pipeline->recognize_seq==pipeline->read_seq&&!pipeline->eos)
+			pthread_cond_wait(&pipeline->slot_read, &pipeline->lock);
+		if (pipeline->recognize_seq==pipeline->read_seq)
+			break;
+		int slot=pipeline->recognize_seq++%pipeline->slots.size();
+		pipeline->states[slot]=BUSY;
+		pthread_mutex_unlock(&pipeline->lock);
+
+		PipelineFrame &frame=pipeline->slots[slot];
+		double recognize_start=GetTime();
+		worker->ssocr.Recognize(SsocrImg(frame.planes, frame.width, frame.height, true), NULL, pipeline->dec_sep, pipeline->neg_sign);
+		frame.digits=worker->ssocr.GetLastRecognizedDigits();
+		worker->recognize_time+=GetTime()-recognize_start;
+
+		pthread_mutex_lock(&pipeline->lock);
+		pipeline->states[slot]=DONE;
+		pthread_cond_broadcast(&pipeline->slot_done);
+	}
+	pthread_mutex_unlock(&pipeline->lock);
+
+	return NULL;
+}
\ No newline at end of file
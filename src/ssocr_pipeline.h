@@ -0,0 +1,99 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SSOCR_PIPELINE_H
+#define SSOCR_PIPELINE_H
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "ssocr.h"
+#include "yuvimg.h"
+
+struct PipelineFrame {
+	int frame;					//Frame number
+	int width;
+	int height;
+	YuvImg::PlaneData planes[3];
+	std::string digits;			//Recognition result
+};
+
+//Reader stage: fills frame views, slot is index of the in-flight frame (0..depth-1) which can be used to pick per-slot buffers
+class PipelineSource {
+public:
+	virtual ~PipelineSource() {}
+	//Returns false on end of stream
+	virtual bool Read(int slot, PipelineFrame &frame)=0;
+	//Called when frame has left the pipeline and it's slot can be reused
+	virtual void Release(int slot) {}
+};
+
+//Ordering stage: called in frame order from the thread that runs the pipeline
+class PipelineSink {
+public:
+	virtual ~PipelineSink() {}
+	virtual void Write(const PipelineFrame &frame)=0;
+};
+
+//Frame-parallel recognition of single stream: reader thread -> N recognizer threads -> in-order writer
+//Number of frames in flight is bounded by depth so memory use doesn't depend on stream length
+class SsocrPipeline {
+public:
+	struct Stats {
+		int frames;
+		double wall_time;		//Seconds
+		double read_time;		//Time spent by reader stage (excluding waits for free slot)
+		double recognize_time;	//Sum of time spent by all recognizer threads
+		double write_time;
+		double read_stall;		//Time reader waited for free slot (pipeline was full)
+		double write_stall;		//Time writer waited for next frame in order
+	};
+private:
+	enum SlotState {FREE, READ, BUSY, DONE};
+
+	struct Worker {
+		SsocrPipeline *pipeline;
+		pthread_t thread;
+		Ssocr ssocr;			//Every thread has it's own recognizer and scratch state
+		double recognize_time;
+		Worker(SsocrPipeline *pipeline, const Ssocr &ssocr): pipeline(pipeline), thread(), ssocr(ssocr), recognize_time(0.0) {}
+	};
+
+	PipelineSource &source;
+	PipelineSink &sink;
+	const char *dec_sep;
+	const char *neg_sign;
+	std::vector<PipelineFrame> slots;
+	std::vector<SlotState> states;
+	std::vector<Worker> workers;
+	pthread_mutex_t lock;
+	pthread_cond_t slot_freed;
+	pthread_cond_t slot_read;
+	pthread_cond_t slot_done;
+	long long read_seq;			//Sequence number of the next frame to read
+	long long recognize_seq;	//Sequence number of the next frame to recognize
+	long long write_seq;		//Sequence number of the next frame to write
+	bool eos;
+	Stats stats;
+
+	static void *ReaderProc(void *arg);
+	static void *WorkerProc(void *arg);
+public:
+	SsocrPipeline(PipelineSource &source, PipelineSink &sink, const Ssocr &ssocr, const char* dec_sep, const char* neg_sign, int threads, int depth);
+	~SsocrPipeline();
+	//Blocks until source is exhausted and all frames are written
+	const Stats &Run();
+	static double GetTime();
+};
+
+#endif //SSOCR_PIPELINE_H
\ No newline at end of file
@@ -0,0 +1,242 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <pthread.h>
+#endif
+#include "ssocr_strips.h"
+
+//Condition variables are missing on Windows 2000/XP, so workers are woken up by semaphore and the last one sets done event
+#ifdef _WIN32
+struct SsocrStripPool::Native {
+	std::vector<HANDLE> threads;
+	CRITICAL_SECTION run_lock;	//Serializes Run
+	HANDLE start;				//Released once for every worker on every Run
+	HANDLE done;				//Set by the last worker that finished current Run
+	volatile long busy;			//Workers that haven't finished current Run
+	bool stop;
+
+	static DWORD WINAPI Proc(LPVOID arg)
+	{
+		SsocrStripPool *pool=(SsocrStripPool*)arg;
+		Native *native=pool->native;
+		for (;;) {
+			WaitForSingleObject(native->start, INFINITE);
+			if (native->stop)
+				break;
+			pool->RunStrips();
+			if (!InterlockedDecrement(&native->busy))
+				SetEvent(native->done);
+		}
+		return 0;
+	}
+};
+
+static inline long AtomicIncrement(volatile long *value)
+{
+	return InterlockedIncrement(value);
+}
+
+SsocrStripPool::SsocrStripPool(int threads):
+	native(new Native()), threads(threads>0?threads:GetCpuCount()), trace(NULL), task(NULL), name(NULL), rows(0), strips(0), next_strip(0)
+{
+	InitializeCriticalSection(&native->run_lock);
+	native->start=CreateSemaphore(NULL, 0, this->threads, NULL);
+	native->done=CreateEvent(NULL, FALSE, FALSE, NULL);
+	native->busy=0;
+	native->stop=false;
+	//Calling thread is one of the pool threads
+	for (int t=1; t<this->threads; t++) {
+		HANDLE thread=CreateThread(NULL, 0, Native::Proc, this, 0, NULL);
+		if (thread)
+			native->threads.push_back(thread);
+	}
+	this->threads=(int)native->threads.size()+1;
+}
+
+SsocrStripPool::~SsocrStripPool()
+{
+	native->stop=true;
+	ReleaseSemaphore(native->start, (LONG)native->threads.size(), NULL);
+	for (size_t t=0; t<native->threads.size(); t++) {
+		WaitForSingleObject(native->threads[t], INFINITE);
+		CloseHandle(native->threads[t]);
+	}
+	CloseHandle(native->start);
+	CloseHandle(native->done);
+	DeleteCriticalSection(&native->run_lock);
+	delete native;
+}
+
+void SsocrStripPool::Dispatch(SsocrStripTask &task, int h, int strips, const char *name)
+{
+	EnterCriticalSection(&native->run_lock);
+	this->task=&task;
+	this->name=name;
+	this->rows=h;
+	this->strips=strips;
+	next_strip=0;
+	native->busy=(long)native->threads.size();
+	ReleaseSemaphore(native->start, (LONG)native->threads.size(), NULL);
+	RunStrips();
+	WaitForSingleObject(native->done, INFINITE);
+	LeaveCriticalSection(&native->run_lock);
+}
+
+int SsocrStripPool::GetCpuCount()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors>0?info.dwNumberOfProcessors:1;
+}
+#else
+struct SsocrStripPool::Native {
+	std::vector<pthread_t> threads;
+	pthread_mutex_t run_lock;	//Serializes Run
+	pthread_mutex_t lock;		//Protects fields below
+	pthread_cond_t start_cond;
+	pthread_cond_t done_cond;
+	long generation;			//Incremented on every Run
+	int busy;					//Workers that haven't finished current Run
+	bool stop;
+
+	static void *Proc(void *arg)
+	{
+		SsocrStripPool *pool=(SsocrStripPool*)arg;
+		Native *native=pool->native;
+		long seen=0;
+		pthread_mutex_lock(&native->lock);
+		for (;;) {
+			while (native->generation==seen&&!native->stop)
+				pthread_cond_wait(&native->start_cond, &native->lock);
+			if (native->stop)
+				break;
+			seen=native->generation;
+			pthread_mutex_unlock(&native->lock);
+			pool->RunStrips();
+			pthread_mutex_lock(&native->lock);
+			if (!--native->busy)
+				pthread_cond_signal(&native->done_cond);
+		}
+		pthread_mutex_unlock(&native->lock);
+		return NULL;
+	}
+};
+
+static inline long AtomicIncrement(volatile long *value)
+{
+	return __sync_add_and_fetch(value, 1);
+}
+
+SsocrStripPool::SsocrStripPool(int threads):
+	native(new Native()), threads(threads>0?threads:GetCpuCount()), trace(NULL), task(NULL), name(NULL), rows(0), strips(0), next_strip(0)
+{
+	pthread_mutex_init(&native->run_lock, NULL);
+	pthread_mutex_init(&native->lock, NULL);
+	pthread_cond_init(&native->start_cond, NULL);
+	pthread_cond_init(&native->done_cond, NULL);
+	native->generation=0;
+	native->busy=0;
+	native->stop=false;
+	//Calling thread is one of the pool threads
+	for (int t=1; t<this->threads; t++) {
+		pthread_t thread;
+		if (!pthread_create(&thread, NULL, Native::Proc, this))
+			native->threads.push_back(thread);
+	}
+	this->threads=(int)native->threads.size()+1;
+}
+
+SsocrStripPool::~SsocrStripPool()
+{
+	pthread_mutex_lock(&native->lock);
+	native->stop=true;
+	pthread_cond_broadcast(&native->start_cond);
+	pthread_mutex_unlock(&native->lock);
+	for (size_t t=0; t<native->threads.size(); t++)
+		pthread_join(native->threads[t], NULL);
+	pthread_cond_destroy(&native->done_cond);
+	pthread_cond_destroy(&native->start_cond);
+	pthread_mutex_destroy(&native->lock);
+	pthread_mutex_destroy(&native->run_lock);
+	delete native;
+}
+
+void SsocrStripPool::Dispatch(SsocrStripTask &task, int h, int strips, const char *name)
+{
+	pthread_mutex_lock(&native->run_lock);
+	this->task=&task;
+	this->name=name;
+	this->rows=h;
+	this->strips=strips;
+	next_strip=0;
+	pthread_mutex_lock(&native->lock);
+	native->busy=(int)native->threads.size();
+	native->generation++;
+	pthread_cond_broadcast(&native->start_cond);
+	pthread_mutex_unlock(&native->lock);
+	RunStrips();
+	pthread_mutex_lock(&native->lock);
+	while (native->busy)
+		pthread_cond_wait(&native->done_cond, &native->lock);
+	pthread_mutex_unlock(&native->lock);
+	pthread_mutex_unlock(&native->run_lock);
+}
+
+int SsocrStripPool::GetCpuCount()
+{
+	long cpus=sysconf(_SC_NPROCESSORS_ONLN);
+	return cpus>0?cpus:1;
+}
+#endif
+
+int SsocrStripPool::GetThreadCount() const
+{
+	return threads;
+}
+
+void SsocrStripPool::SetTrace(SsocrTrace *trace)
+{
+	this->trace=trace;
+}
+
+//Strips are taken in order by whichever thread is free, so a late worker just finds them all done
+void SsocrStripPool::RunStrips()
+{
+	for (long s; (s=AtomicIncrement(&next_strip)-1)<strips;) {
+		SsocrTicks start=SsocrTrace::Start(trace);
+		task->Run(s, rows*s/strips, rows*(s+1)/strips);
+		SsocrTrace::Stop(trace, name, start);
+	}
+}
+
+int SsocrStripPool::GetStripCount(const SsocrStripPool *pool, int h)
+{
+	if (!pool)
+		return 1;
+	int strips=h/STRIP_MIN_ROWS;
+	return strips<1?1:(strips>pool->threads?pool->threads:strips);
+}
+
+void SsocrStripPool::Run(SsocrStripPool *pool, SsocrStripTask &task, int h, const char *name)
+{
+	int strips=GetStripCount(pool, h);
+	if (strips>1)
+		pool->Dispatch(task, h, strips, name);
+	else
+		task.Run(0, 0, h);
+}
\ No newline at end of file
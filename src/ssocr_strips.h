@@ -0,0 +1,61 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SSOCR_STRIPS_H
+#define SSOCR_STRIPS_H
+
+#include "ssocr_trace.h"
+
+/* frame is split into strips of at least STRIP_MIN_ROWS rows, smaller frames aren't worth waking threads up */
+#define STRIP_MIN_ROWS 64
+
+class SsocrStripTask {
+public:
+	virtual ~SsocrStripTask() {}
+	//Processes rows [y1,y2) of strip, strips of single Run are processed concurrently
+	virtual void Run(int strip, int y1, int y2)=0;
+};
+
+//Persistent thread pool that splits single frame operation (threshold statistics, binarization, projection profiles) into horizontal strips
+//Threads are started once and sleep between frames, so frame costs a wake-up instead of thread creation
+//Calling thread processes strips too, Run calls from different threads are serialized
+//Code using the pool holds SsocrStripPool pointer that is NULL when frame is processed by calling thread only:
+//Run and GetStripCount are static and process whole frame as single strip in this case
+class SsocrStripPool {
+private:
+	struct Native;				//Native threads and wake-up signals
+	Native *native;
+	int threads;
+	SsocrTrace *trace;			//NULL if tracing is disabled
+	SsocrStripTask *task;		//Task of the current Run
+	const char *name;
+	int rows;
+	int strips;
+	volatile long next_strip;	//Next strip to be taken by any thread
+
+	void RunStrips();
+	void Dispatch(SsocrStripTask &task, int h, int strips, const char *name);
+public:
+	//Pool with threads<=0 uses all CPUs
+	SsocrStripPool(int threads);
+	~SsocrStripPool();
+	int GetThreadCount() const;
+	//Strips are traced under name in the thread that processed them
+	void SetTrace(SsocrTrace *trace);
+	static int GetStripCount(const SsocrStripPool *pool, int h);
+	//Splits rows [0,h) into GetStripCount(pool, h) strips and blocks until task has processed all of them
+	static void Run(SsocrStripPool *pool, SsocrStripTask &task, int h, const char *name);
+	static int GetCpuCount();
+};
+
+#endif //SSOCR_STRIPS_H
\ No newline at end of file
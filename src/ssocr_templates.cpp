@@ -0,0 +1,174 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <sstream>
+#include "ssocr_templates.h"
+
+/* glyphs are drawn on canvas scaled TEMPLATE_SCALE times from the fingerprint grid */
+#define TEMPLATE_SCALE 4
+
+static const int template_digits[]={D_ZERO, D_TWO, D_THREE, D_FOUR, D_FIVE, D_SIX, D_SEVEN, D_ALTSEVEN, D_EIGHT, D_NINE, D_ALTNINE,
+	D_HEX_A, D_HEX_b, D_HEX_C, D_HEX_c, D_HEX_d, D_HEX_E, D_HEX_F};
+
+//GCC emits POPCNT instruction when it's enabled (e.g. -mpopcnt or -march=native), bit twiddling otherwise
+#ifdef __GNUC__
+static inline int Popcount(unsigned int value)
+{
+	return __builtin_popcount(value);
+}
+#else
+static inline int Popcount(unsigned int value)
+{
+	value=value-((value>>1)&0x55555555);
+	value=(value&0x33333333)+((value>>2)&0x33333333);
+	return (((value+(value>>4))&0x0F0F0F0F)*0x01010101)>>24;
+}
+#endif
+
+SsocrTemplates::SsocrTemplates():
+	templates(sizeof(template_digits)/sizeof(template_digits[0])), learn_frames(0)
+{
+	SetLearning(0);
+}
+
+void SsocrTemplates::SetLearning(int frames)
+{
+	for (size_t t=0; t<templates.size(); t++) {
+		templates[t].digit=template_digits[t];
+		Draw(templates[t].digit, templates[t].bits);
+		templates[t].samples=0;
+		memset(templates[t].votes, 0, sizeof(templates[t].votes));
+	}
+	learn_frames=frames;
+}
+
+bool SsocrTemplates::IsLearning() const
+{
+	return learn_frames>0;
+}
+
+/* segments are drawn like on SegRender display and cropped to their bounding box,
+* which is sampled like digit cell: box and the light column and row after it */
+void SsocrTemplates::Draw(int digit, unsigned int *bits)
+{
+	const int cw=GLYPH_W*TEMPLATE_SCALE, ch=GLYPH_H*TEMPLATE_SCALE;
+	int t=(int)(ch*TEMPLATE_THICKNESS+0.5);
+	bool canvas[GLYPH_H*TEMPLATE_SCALE][GLYPH_W*TEMPLATE_SCALE];
+	int x1=cw, y1=ch, x2=-1, y2=-1;
+
+	for (int j=0; j<ch; j++)
+		for (int i=0; i<cw; i++) {
+			bool set=false;
+			if (digit&HORIZ_UP) set|=j<t;
+			if (digit&HORIZ_MID) set|=j>=(ch-t)/2&&j<(ch-t)/2+t;
+			if (digit&HORIZ_DOWN) set|=j>=ch-t;
+			if (digit&VERT_LEFT_UP) set|=i<t&&j<ch/2;
+			if (digit&VERT_RIGHT_UP) set|=i>=cw-t&&j<ch/2;
+			if (digit&VERT_LEFT_DOWN) set|=i<t&&j>=ch/2;
+			if (digit&VERT_RIGHT_DOWN) set|=i>=cw-t&&j>=ch/2;
+			canvas[j][i]=set;
+			if (set) {
+				x1=i<x1?i:x1;
+				y1=j<y1?j:y1;
+				x2=i>x2?i:x2;
+				y2=j>y2?j:y2;
+			}
+		}
+
+	memset(bits, 0, WORDS*sizeof(unsigned int));
+	for (int gy=0; gy<GLYPH_H; gy++) {
+		int j=y1+(2*gy+1)*(y2-y1+2)/(2*GLYPH_H);
+		for (int gx=0; gx<GLYPH_W; gx++) {
+			int i=x1+(2*gx+1)*(x2-x1+2)/(2*GLYPH_W);
+			if (i<=x2&&j<=y2&&canvas[j][i])
+				bits[(GLYPH_W*gy+gx)/32]|=1u<<((GLYPH_W*gy+gx)%32);
+		}
+	}
+}
+
+void SsocrTemplates::Learn(const unsigned int *bits, int digit)
+{
+	for (size_t t=0; t<templates.size(); t++)
+		if (templates[t].digit==digit) {
+			templates[t].samples++;
+			for (int b=0; b<GLYPH_W*GLYPH_H; b++)
+				templates[t].votes[b]+=(bits[b/32]>>(b%32))&1;
+			return;
+		}
+}
+
+void SsocrTemplates::EndFrame()
+{
+	if (learn_frames<=0||--learn_frames)
+		return;
+	for (size_t t=0; t<templates.size(); t++) {
+		if (templates[t].samples<TEMPLATE_MIN_SAMPLES)
+			continue;
+		memset(templates[t].bits, 0, sizeof(templates[t].bits));
+		for (int b=0; b<GLYPH_W*GLYPH_H; b++)
+			if (2*templates[t].votes[b]>templates[t].samples)
+				templates[t].bits[b/32]|=1u<<(b%32);
+	}
+}
+
+int SsocrTemplates::Classify(const unsigned int *bits) const
+{
+	int best=D_UNKNOWN, best_distance=TEMPLATE_MAX_DISTANCE+1;
+	for (size_t t=0; t<templates.size(); t++) {
+		int distance=0;
+		for (int w=0; w<WORDS; w++)
+			distance+=Popcount(bits[w]^templates[t].bits[w]);
+		if (distance<best_distance) {
+			best_distance=distance;
+			best=templates[t].digit;
+		}
+	}
+	return best;
+}
+
+//Frames left, then every template: bits, samples and votes
+std::string SsocrTemplates::GetState() const
+{
+	std::ostringstream state;
+	state<<learn_frames;
+	for (size_t t=0; t<templates.size(); t++) {
+		for (int w=0; w<WORDS; w++)
+			state<<' '<<templates[t].bits[w];
+		state<<' '<<templates[t].samples;
+		for (int b=0; b<GLYPH_W*GLYPH_H; b++)
+			state<<' '<<templates[t].votes[b];
+	}
+	return state.str();
+}
+
+bool SsocrTemplates::SetState(const std::string &state)
+{
+	std::istringstream iss(state);
+	std::vector<Template> loaded(templates);
+	int loaded_frames;
+	if (!(iss>>loaded_frames))
+		return false;
+	for (size_t t=0; t<loaded.size(); t++) {
+		for (int w=0; w<WORDS; w++)
+			iss>>loaded[t].bits[w];
+		iss>>loaded[t].samples;
+		for (int b=0; b<GLYPH_W*GLYPH_H; b++)
+			iss>>loaded[t].votes[b];
+	}
+	if (iss.fail())
+		return false;
+	templates.swap(loaded);
+	learn_frames=loaded_frames;
+	return true;
+}
\ No newline at end of file
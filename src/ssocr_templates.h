@@ -0,0 +1,57 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SSOCR_TEMPLATES_H
+#define SSOCR_TEMPLATES_H
+
+#include <string>
+#include <vector>
+#include "ssocr_defines.h"
+
+//Classifies digit cells by Hamming distance between cell fingerprint (see SsocrGlyphCache::Key) and templates of glyphs
+//Unlike segment scanlines, noisy pixel only adds one to the distance instead of breaking the segment
+//Built-in templates are drawn from segment masks and cropped like digit cells are,
+//learned ones are majority of fingerprints of cells decoded by scanlines during first frames
+//Ones, decimal points, minus signs and colons are classified by size before, so they have no templates
+class SsocrTemplates {
+public:
+	enum {WORDS=GLYPH_W*GLYPH_H/32};
+private:
+	struct Template {
+		int digit;
+		unsigned int bits[WORDS];
+		int samples;					//Learned fingerprints
+		int votes[GLYPH_W*GLYPH_H];		//Learned fingerprints that have the bit set
+	};
+
+	std::vector<Template> templates;
+	int learn_frames;					//Frames left to learn from
+
+	static void Draw(int digit, unsigned int *bits);
+public:
+	SsocrTemplates();
+	//Resets to built-in templates, next frames frames are decoded by scanlines and learned
+	void SetLearning(int frames);
+	bool IsLearning() const;
+	//Cell decoded by scanlines while learning, digits without template are ignored
+	void Learn(const unsigned int *bits, int digit);
+	//Counts learned frame, templates are replaced when the last one ends
+	void EndFrame();
+	//Digit of the closest template or D_UNKNOWN if none is within TEMPLATE_MAX_DISTANCE
+	int Classify(const unsigned int *bits) const;
+	//Templates and learning progress as text (see Ssocr::GetState), SetState returns false if state is malformed
+	std::string GetState() const;
+	bool SetState(const std::string &state);
+};
+
+#endif //SSOCR_TEMPLATES_H
\ No newline at end of file
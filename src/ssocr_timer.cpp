@@ -0,0 +1,106 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include "ssocr_timer.h"
+
+SsocrTimer::SsocrTimer(int fps_numerator, int fps_denominator, int interval):
+	fduration(((double)fps_denominator/fps_numerator*1000)), timer(interval*1000)
+{}
+
+unsigned int SsocrTimer::GetMseconds(int cur_frame) const
+{
+	return Round(fduration*cur_frame);
+}
+
+bool SsocrTimer::CheckTimer(unsigned int cur_mseconds) const
+{
+	if (!timer)
+		return true;
+
+	unsigned int last_alarm=cur_mseconds-cur_mseconds%timer;
+	if (cur_mseconds>=last_alarm&&cur_mseconds<(last_alarm+Round(fduration)))
+		return true;
+	else
+		return false;
+}
+
+int SsocrTimer::GetNextAlarm(int cur_frame) const
+{
+	for (;;) {
+		unsigned int cur_mseconds=GetMseconds(cur_frame);
+		if (CheckTimer(cur_mseconds))
+			return cur_frame;
+
+		//Jump straight to the frame of the next alarm instead of checking every frame in between
+		unsigned int next_alarm=cur_mseconds-cur_mseconds%timer+timer;
+		int next_frame=(int)(next_alarm/fduration);
+		cur_frame=next_frame>cur_frame?next_frame:cur_frame+1;
+		while (GetMseconds(cur_frame)<next_alarm)
+			cur_frame++;
+	}
+}
+
+int SsocrTimer::GetSampleFrame(int sample) const
+{
+	//If interval doesn't exceed frame duration every frame is a sample
+	if (timer<=ceil(fduration))
+		return sample;
+
+	unsigned int sample_mseconds=sample*timer;
+	int cur_frame=(int)ceil(sample_mseconds/fduration);
+	//Estimate can be off by one frame because of rounding in GetMseconds
+	while (cur_frame>0&&GetMseconds(cur_frame-1)>=sample_mseconds)
+		cur_frame--;
+	while (GetMseconds(cur_frame)<sample_mseconds)
+		cur_frame++;
+	return cur_frame;
+}
+
+int SsocrTimer::GetSampleCount(int num_frames) const
+{
+	if (timer<=ceil(fduration)||num_frames<=0)
+		return num_frames;
+	else
+		return GetMseconds(num_frames-1)/timer+1;
+}
+
+//Rounding algorithm from Java 7
+int SsocrTimer::Round(double num)
+{
+	if (num!=0.49999999999999994)
+		return (int)floor(num+0.5);
+	else
+		return 0;
+}
+
+std::string SsocrTimer::GetTimestamp(unsigned int cur_mseconds)
+{
+	std::ostringstream out_str;
+
+	unsigned int dsp_mseconds=cur_mseconds%1000;
+	unsigned int dsp_seconds=cur_mseconds/1000%60;
+	unsigned int dsp_minutes=cur_mseconds/60000%60;
+	unsigned int dsp_hours=cur_mseconds/3600000;
+
+	out_str.fill('0');
+	if (dsp_hours>99)
+		out_str<<"EE";
+	else
+		out_str<<std::setw(2)<<dsp_hours;
+	out_str<<':'<<std::setw(2)<<dsp_minutes<<':'<<std::setw(2)<<dsp_seconds<<'.'<<std::setw(3)<<dsp_mseconds;
+
+	return out_str.str();
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SSOCR_TIMER_H
+#define SSOCR_TIMER_H
+
+#include <string>
+
+//Frame timing shared by AviSynth filter and command line tools
+class SsocrTimer {
+private:
+	double fduration;			//Frame duration in mseconds
+	unsigned int timer;			//Timer in mseconds
+public:
+	SsocrTimer(int fps_numerator, int fps_denominator, int interval);
+	unsigned int GetMseconds(int cur_frame) const;
+	bool CheckTimer(unsigned int cur_mseconds) const;
+	//Returns first frame starting from cur_frame for which CheckTimer is true
+	int GetNextAlarm(int cur_frame) const;
+	//Sparse sampling: one sample per interval - first frame at or after interval start
+	int GetSampleFrame(int sample) const;
+	int GetSampleCount(int num_frames) const;
+	static int Round(double num);
+	static std::string GetTimestamp(unsigned int cur_mseconds);
+};
+
+#endif //SSOCR_TIMER_H
\ No newline at end of file
@@ -0,0 +1,161 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <fstream>
+#include <iomanip>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#endif
+#include "ssocr_trace.h"
+
+//Static TLS (__declspec(thread)) doesn't work in DLLs loaded by LoadLibrary on Windows 2000/XP, so dynamic TLS is used
+#ifdef _WIN32
+SsocrTrace::SsocrTrace():
+	tls((void*)(size_t)TlsAlloc()), lock(new CRITICAL_SECTION), threads(), origin(Now())
+{
+	InitializeCriticalSection((CRITICAL_SECTION*)lock);
+}
+
+SsocrTrace::~SsocrTrace()
+{
+	TlsFree((DWORD)(size_t)tls);
+	DeleteCriticalSection((CRITICAL_SECTION*)lock);
+	delete (CRITICAL_SECTION*)lock;
+	for (std::vector<ThreadSpans*>::iterator it=threads.begin(); it!=threads.end(); it++)
+		delete *it;
+}
+
+SsocrTrace::ThreadSpans *SsocrTrace::GetThreadSpans()
+{
+	ThreadSpans *thread_spans=(ThreadSpans*)TlsGetValue((DWORD)(size_t)tls);
+	if (!thread_spans) {
+		thread_spans=new ThreadSpans();
+		EnterCriticalSection((CRITICAL_SECTION*)lock);
+		threads.push_back(thread_spans);
+		thread_spans->tid=threads.size();
+		LeaveCriticalSection((CRITICAL_SECTION*)lock);
+		TlsSetValue((DWORD)(size_t)tls, thread_spans);
+	}
+	return thread_spans;
+}
+
+SsocrTicks SsocrTrace::Now()
+{
+	LARGE_INTEGER ticks;
+	QueryPerformanceCounter(&ticks);
+	return ticks.QuadPart;
+}
+
+double SsocrTrace::GetTickFrequency()
+{
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	return (double)freq.QuadPart;
+}
+
+static unsigned long GetPid()
+{
+	return GetCurrentProcessId();
+}
+#else
+SsocrTrace::SsocrTrace():
+	tls(new pthread_key_t), lock(new pthread_mutex_t), threads(), origin(Now())
+{
+	pthread_key_create((pthread_key_t*)tls, NULL);
+	pthread_mutex_init((pthread_mutex_t*)lock, NULL);
+}
+
+SsocrTrace::~SsocrTrace()
+{
+	pthread_key_delete(*(pthread_key_t*)tls);
+	delete (pthread_key_t*)tls;
+	pthread_mutex_destroy((pthread_mutex_t*)lock);
+	delete (pthread_mutex_t*)lock;
+	for (std::vector<ThreadSpans*>::iterator it=threads.begin(); it!=threads.end(); it++)
+		delete *it;
+}
+
+SsocrTrace::ThreadSpans *SsocrTrace::GetThreadSpans()
+{
+	ThreadSpans *thread_spans=(ThreadSpans*)pthread_getspecific(*(pthread_key_t*)tls);
+	if (!thread_spans) {
+		thread_spans=new ThreadSpans();
+		pthread_mutex_lock((pthread_mutex_t*)lock);
+		threads.push_back(thread_spans);
+		thread_spans->tid=threads.size();
+		pthread_mutex_unlock((pthread_mutex_t*)lock);
+		pthread_setspecific(*(pthread_key_t*)tls, thread_spans);
+	}
+	return thread_spans;
+}
+
+SsocrTicks SsocrTrace::Now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (SsocrTicks)ts.tv_sec*1000000000+ts.tv_nsec;
+}
+
+double SsocrTrace::GetTickFrequency()
+{
+	return 1000000000.0;
+}
+
+static unsigned long GetPid()
+{
+	return getpid();
+}
+#endif
+
+void SsocrTrace::AddSpan(const char *name, SsocrTicks start, SsocrTicks end)
+{
+	ThreadSpans *thread_spans=GetThreadSpans();
+	if (thread_spans->spans.size()>=SSOCR_TRACE_MAX_SPANS) {
+		thread_spans->dropped++;
+		return;
+	}
+	Span span={name, start, end};
+	thread_spans->spans.push_back(span);
+}
+
+//Should be called when traced threads are stopped
+bool SsocrTrace::Dump(const std::string &path)
+{
+	std::ofstream out(path.c_str(), std::ios::trunc);
+	double us_per_tick=1000000.0/GetTickFrequency();
+	bool first=true;
+
+	if (!out.is_open())
+		return false;
+
+	out<<std::fixed<<std::setprecision(3);
+	out<<"{\"traceEvents\":[";
+	for (std::vector<ThreadSpans*>::iterator it=threads.begin(); it!=threads.end(); it++)
+		for (std::vector<Span>::iterator sp=(*it)->spans.begin(); sp!=(*it)->spans.end(); sp++) {
+			out<<(first?"\n":",\n");
+			out<<"{\"name\":\""<<sp->name<<"\",\"ph\":\"X\",\"pid\":"<<GetPid()<<",\"tid\":"<<(*it)->tid
+				<<",\"ts\":"<<(sp->start-origin)*us_per_tick<<",\"dur\":"<<(sp->end-sp->start)*us_per_tick<<"}";
+			first=false;
+		}
+	out<<"\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_spans\":\"";
+	size_t dropped=0;
+	for (std::vector<ThreadSpans*>::iterator it=threads.begin(); it!=threads.end(); it++)
+		dropped+=(*it)->dropped;
+	out<<dropped<<"\"}}"<<std::endl;
+
+	return out.good();
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SSOCR_TRACE_H
+#define SSOCR_TRACE_H
+
+#include <string>
+#include <vector>
+
+/* maximum number of spans recorded by single thread, the rest is dropped */
+#define SSOCR_TRACE_MAX_SPANS 1000000
+
+typedef long long SsocrTicks;
+
+//Per-thread buffered timing spans, dumped as Chrome trace-event JSON (chrome://tracing)
+//Code being traced holds SsocrTrace pointer that is NULL when tracing is disabled:
+//Start/Stop are static and cost single predictable branch in this case
+class SsocrTrace {
+private:
+	struct Span {
+		const char *name;		//Should be string literal
+		SsocrTicks start;
+		SsocrTicks end;
+	};
+
+	struct ThreadSpans {
+		unsigned long tid;
+		size_t dropped;
+		std::vector<Span> spans;
+	};
+
+	void *tls;					//Native TLS slot with ThreadSpans of current thread
+	void *lock;					//Protects threads list
+	std::vector<ThreadSpans*> threads;
+	SsocrTicks origin;
+
+	ThreadSpans *GetThreadSpans();
+	void AddSpan(const char *name, SsocrTicks start, SsocrTicks end);
+public:
+	SsocrTrace();
+	~SsocrTrace();
+	//Writes all recorded spans to file, returns false on error
+	bool Dump(const std::string &path);
+	static SsocrTicks Now();
+	static double GetTickFrequency();
+	static SsocrTicks Start(SsocrTrace *trace) { return trace?Now():0; }
+	static void Stop(SsocrTrace *trace, const char *name, SsocrTicks start) { if (trace) trace->AddSpan(name, start, Now()); }
+};
+
+#endif //SSOCR_TRACE_H
\ No newline at end of file
@@ -0,0 +1,246 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdlib>
+#include "ssocr_tracker.h"
+
+SsocrTracker::SsocrTracker(bool black_on_white):
+	black_on_white(black_on_white), tracking(false), tracked(0), x(0), y(0), w(0), h(0), small(), display(), integral(), labels(), stack(), blobs()
+{}
+
+bool SsocrTracker::Locate(const SsocrImg &img, int &x, int &y, int &w, int &h)
+{
+	if (tracking&&tracked<TRACK_REFRESH&&Track(img)) {
+		tracked++;
+	} else {
+		tracking=Localize(img);
+		tracked=0;
+	}
+
+	if (tracking) {
+		x=this->x*TRACK_SCALE;
+		y=this->y*TRACK_SCALE;
+		w=this->w*TRACK_SCALE;
+		h=this->h*TRACK_SCALE;
+	} else {
+		x=0;
+		y=0;
+		w=img.GetWidth();
+		h=img.GetHeight();
+	}
+
+	return tracking;
+}
+
+void SsocrTracker::Lose()
+{
+	tracking=false;
+}
+
+/* finds the densest cluster of segment-like blobs in the downsampled frame */
+bool SsocrTracker::Localize(const SsocrImg &img)
+{
+	int sw=img.GetWidth()/TRACK_SCALE;
+	int sh=img.GetHeight()/TRACK_SCALE;
+
+	if (sw<2*TRACK_SEARCH||sh<2*TRACK_SEARCH)
+		return false;
+
+	small.resize(sw*sh);
+	img.downsample(TRACK_SCALE, 0, 0, sw, sh, &small[0]);
+	FindBlobs(sw, sh);
+	if (blobs.empty())
+		return false;
+
+	/* digit-like blobs of similar height belong to the same cluster if they are closer than their height
+	* horizontally (gap between digits) and closer than half of the height vertically (gap between segments) */
+	for (size_t a=0; a<blobs.size(); a++)
+		for (size_t b=a+1; b<blobs.size(); b++) {
+			int ha=blobs[a].y2-blobs[a].y1+1, hb=blobs[b].y2-blobs[b].y1+1;
+			int dist=std::max(ha, hb);
+			int gap_x=std::max(blobs[a].x1, blobs[b].x1)-std::min(blobs[a].x2, blobs[b].x2)-1;
+			int gap_y=std::max(blobs[a].y1, blobs[b].y1)-std::min(blobs[a].y2, blobs[b].y2)-1;
+			if (IsDigitLike(blobs[a])&&IsDigitLike(blobs[b])&&dist*4<=std::min(ha, hb)*5+4&&gap_x<=dist&&gap_y*2<=dist)
+				blobs[FindCluster(a)].cluster=FindCluster(b);
+		}
+
+	/* root blob accumulates bounding box, area and number of digit-like blobs of the whole cluster */
+	std::vector<int> count(blobs.size(), 0);
+	for (size_t b=0; b<blobs.size(); b++) {
+		int root=FindCluster(b);
+		count[root]+=IsDigitLike(blobs[b]);
+		if (root==(int)b)
+			continue;
+		blobs[root].x1=std::min(blobs[root].x1, blobs[b].x1);
+		blobs[root].y1=std::min(blobs[root].y1, blobs[b].y1);
+		blobs[root].x2=std::max(blobs[root].x2, blobs[b].x2);
+		blobs[root].y2=std::max(blobs[root].y2, blobs[b].y2);
+		blobs[root].area+=blobs[b].area;
+	}
+
+	/* display is the cluster with the most digit-like blobs */
+	int best=-1;
+	for (size_t b=0; b<blobs.size(); b++)
+		if (count[b]&&(best<0||count[b]>count[best]||(count[b]==count[best]&&blobs[b].area>blobs[best].area)))
+			best=b;
+	if (best<0)
+		return false;
+
+	/* small blobs (decimal points, minus signs, separate segments) that are in line with the digits are added to the display */
+	int x1=blobs[best].x1, y1=blobs[best].y1, x2=blobs[best].x2, y2=blobs[best].y2;
+	for (bool grown=true; grown;) {
+		grown=false;
+		for (size_t b=0; b<blobs.size(); b++)
+			if (blobs[b].y1>=y1-1&&blobs[b].y2<=y2+1&&(blobs[b].y2-blobs[b].y1)*2<=y2-y1&&(blobs[b].x1<x1||blobs[b].x2>x2)&&
+				std::max(blobs[b].x1, x1)-std::min(blobs[b].x2, x2)-1<=y2-y1+1) {
+				x1=std::min(x1, blobs[b].x1);
+				x2=std::max(x2, blobs[b].x2);
+				grown=true;
+			}
+	}
+
+	int margin=std::max(1, (int)((y2-y1+1)*LOCATE_MARGIN+0.5));
+	x=std::max(x1-margin, 0);
+	y=std::max(y1-margin, 0);
+	w=std::min(x2+margin+1, sw)-x;
+	h=std::min(y2+margin+1, sh)-y;
+	SaveDisplay(0, 0, sw);
+
+	return true;
+}
+
+/* block matching of the display from the previous frame in the search window around its last position */
+bool SsocrTracker::Track(const SsocrImg &img)
+{
+	int sw=img.GetWidth()/TRACK_SCALE;
+	int sh=img.GetHeight()/TRACK_SCALE;
+
+	if (x+w>sw||y+h>sh)
+		return false;
+
+	int sx1=std::max(x-TRACK_SEARCH, 0);
+	int sy1=std::max(y-TRACK_SEARCH, 0);
+	int sx2=std::min(x+w+TRACK_SEARCH, sw);
+	int sy2=std::min(y+h+TRACK_SEARCH, sh);
+	int ww=sx2-sx1;
+
+	small.resize(ww*(sy2-sy1));
+	img.downsample(TRACK_SCALE, sx1, sy1, ww, sy2-sy1, &small[0]);
+
+	/* candidates are checked from the last position outwards, so the sum can be dropped as soon as it exceeds the best one */
+	unsigned int best_sad=~0u;
+	int best_x=x, best_y=y;
+	for (int r=0; r<=TRACK_SEARCH; r++)
+		for (int py=y-r; py<=y+r; py++)
+			for (int px=x-r; px<=x+r; px++) {
+				if ((abs(px-x)!=r&&abs(py-y)!=r)||px<sx1||py<sy1||px+w>sx2||py+h>sy2)
+					continue;
+				unsigned int sad=0;
+				for (int j=0; j<h&&sad<best_sad; j++) {
+					const unsigned char *row=&small[ww*(py-sy1+j)+px-sx1];
+					const unsigned char *ref=&display[w*j];
+					for (int i=0; i<w; i++)
+						sad+=abs(row[i]-ref[i]);
+				}
+				if (sad<best_sad) {
+					best_sad=sad;
+					best_x=px;
+					best_y=py;
+				}
+			}
+
+	if (best_sad>TRACK_LOST_DIFF*w*h)
+		return false;
+
+	/* display is updated every frame to follow changing digits and lighting */
+	x=best_x;
+	y=best_y;
+	SaveDisplay(sx1, sy1, ww);
+
+	return true;
+}
+
+/* labels 4-connected blobs of pixels that differ from the window mean in digit's direction,
+* blobs touching the edge of the frame, too big to be a segment or a digit, or solid rectangles are dropped */
+void SsocrTracker::FindBlobs(int sw, int sh)
+{
+	int r=std::max(std::min(sw, sh)/LOCATE_WINDOW_DIV/2, 2);
+
+	integral.assign((sw+1)*(sh+1), 0);
+	for (int j=0; j<sh; j++)
+		for (int i=0; i<sw; i++)
+			integral[(sw+1)*(j+1)+i+1]=integral[(sw+1)*j+i+1]+integral[(sw+1)*(j+1)+i]-integral[(sw+1)*j+i]+small[sw*j+i];
+
+	/* 0 - unvisited foreground, -1 - background or visited */
+	labels.resize(sw*sh);
+	for (int j=0; j<sh; j++) {
+		int y1=std::max(j-r, 0), y2=std::min(j+r+1, sh);
+		for (int i=0; i<sw; i++) {
+			int x1=std::max(i-r, 0), x2=std::min(i+r+1, sw);
+			int sum=integral[(sw+1)*y2+x2]-integral[(sw+1)*y1+x2]-integral[(sw+1)*y2+x1]+integral[(sw+1)*y1+x1];
+			int diff=small[sw*j+i]*(x2-x1)*(y2-y1)-sum;
+			labels[sw*j+i]=(black_on_white?-diff:diff)>=LOCATE_CONTRAST*(x2-x1)*(y2-y1)?0:-1;
+		}
+	}
+
+	blobs.clear();
+	for (int start=0; start<sw*sh; start++) {
+		if (labels[start])
+			continue;
+		Blob blob={sw, sh, -1, -1, 0, (int)blobs.size()};
+		labels[start]=-1;
+		stack.push_back(start);
+		while (!stack.empty()) {
+			int p=stack.back(), i=p%sw, j=p/sw;
+			stack.pop_back();
+			blob.x1=std::min(blob.x1, i);
+			blob.y1=std::min(blob.y1, j);
+			blob.x2=std::max(blob.x2, i);
+			blob.y2=std::max(blob.y2, j);
+			blob.area++;
+			if (i>0&&!labels[p-1]) { labels[p-1]=-1; stack.push_back(p-1); }
+			if (i<sw-1&&!labels[p+1]) { labels[p+1]=-1; stack.push_back(p+1); }
+			if (j>0&&!labels[p-sw]) { labels[p-sw]=-1; stack.push_back(p-sw); }
+			if (j<sh-1&&!labels[p+sw]) { labels[p+sw]=-1; stack.push_back(p+sw); }
+		}
+		if (blob.x1>0&&blob.y1>0&&blob.x2<sw-1&&blob.y2<sh-1&&blob.area>=3&&
+			blob.x2-blob.x1<sw/3&&blob.y2-blob.y1<sh*3/4&&
+			!(blob.x2-blob.x1>=3&&blob.y2-blob.y1>=3&&blob.area*10>(blob.x2-blob.x1+1)*(blob.y2-blob.y1+1)*9))
+			blobs.push_back(blob);
+	}
+}
+
+/* digit or segment is not wider than it's height and is not a thin outline, unlike edges of objects */
+bool SsocrTracker::IsDigitLike(const Blob &blob)
+{
+	int bw=blob.x2-blob.x1+1, bh=blob.y2-blob.y1+1;
+	return bh>=LOCATE_MIN_HEIGHT&&bw<=bh&&blob.area*4>=bw*bh;
+}
+
+int SsocrTracker::FindCluster(int b)
+{
+	while (blobs[b].cluster!=b) {
+		blobs[b].cluster=blobs[blobs[b].cluster].cluster;
+		b=blobs[b].cluster;
+	}
+	return b;
+}
+
+/* copies display region from small buffer that starts at (sx,sy) and is sw pixels wide */
+void SsocrTracker::SaveDisplay(int sx, int sy, int sw)
+{
+	display.resize(w*h);
+	for (int j=0; j<h; j++)
+		std::copy(&small[sw*(y-sy+j)+x-sx], &small[sw*(y-sy+j)+x-sx]+w, &display[w*j]);
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SSOCR_TRACKER_H
+#define SSOCR_TRACKER_H
+
+#include <vector>
+#include "ssocr_imgproc.h"
+
+//Finds display region in the frame and follows it from frame to frame, so only the region is recognized
+//Localization looks for the densest cluster of segment-like blobs in downsampled frame
+//Tracking matches display from the previous frame against downsampled luminance around its last position
+//All coordinates are kept in downsampled pixels (see TRACK_SCALE in ssocr_defines.h)
+class SsocrTracker {
+private:
+	struct Blob {
+		int x1, y1, x2, y2;		//Bounding box, inclusive
+		int area;
+		int cluster;			//Index of the cluster's root blob
+	};
+
+	bool black_on_white;
+	bool tracking;				//False until display is found and after it's lost
+	int tracked;				//Frames tracked since localization
+	int x, y, w, h;				//Display region
+	std::vector<unsigned char> small;		//Downsampled luminance of the frame or search window
+	std::vector<unsigned char> display;		//Downsampled luminance of the display region at last position
+	std::vector<unsigned int> integral;
+	std::vector<int> labels;
+	std::vector<int> stack;
+	std::vector<Blob> blobs;
+
+	bool Localize(const SsocrImg &img);
+	bool Track(const SsocrImg &img);
+	void FindBlobs(int sw, int sh);
+	int FindCluster(int b);
+	static bool IsDigitLike(const Blob &blob);
+	void SaveDisplay(int sx, int sy, int sw);
+public:
+	SsocrTracker(bool black_on_white);
+	//Region of the display in image pixels, whole image if display can't be found (returns false in this case)
+	bool Locate(const SsocrImg &img, int &x, int &y, int &w, int &h);
+	//Forces localization on the next frame (e.g. when nothing was recognized in the region)
+	void Lose();
+};
+
+#endif //SSOCR_TRACKER_H
\ No newline at end of file
@@ -0,0 +1,110 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <unistd.h>
+#include "wspool.h"
+
+WsPool::WsPool(int threads):
+	workers(threads>0?threads:1), next_worker(0)
+{
+	for (size_t w=0; w<workers.size(); w++) {
+		workers[w].pool=this;
+		workers[w].index=w;
+		pthread_mutex_init(&workers[w].lock, NULL);
+	}
+}
+
+WsPool::~WsPool()
+{
+	for (size_t w=0; w<workers.size(); w++) {
+		for (std::deque<WsTask*>::iterator it=workers[w].tasks.begin(); it!=workers[w].tasks.end(); it++)
+			delete *it;
+		pthread_mutex_destroy(&workers[w].lock);
+	}
+}
+
+int WsPool::GetThreadCount() const
+{
+	return workers.size();
+}
+
+void WsPool::Submit(WsTask *task)
+{
+	//Initial distribution is round-robin, stealing evens out the rest
+	workers[next_worker].tasks.push_back(task);
+	next_worker=(next_worker+1)%workers.size();
+}
+
+void WsPool::Run()
+{
+	//Worker 0 is the calling thread
+	for (size_t w=1; w<workers.size(); w++)
+		if (pthread_create(&workers[w].thread, NULL, WorkerProc, &workers[w]))
+			workers[w].thread=pthread_self();
+	WorkerProc(&workers[0]);
+	for (size_t w=1; w<workers.size(); w++)
+		if (!pthread_equal(workers[w].thread, pthread_self()))
+			pthread_join(workers[w].thread, NULL);
+		else
+			WorkerProc(&workers[w]);	//Thread wasn't created - drain it's queue here
+	next_worker=0;
+}
+
+WsTask *WsPool::Pop(int index)
+{
+	WsTask *task=NULL;
+	pthread_mutex_lock(&workers[index].lock);
+	if (!workers[index].tasks.empty()) {
+		task=workers[index].tasks.front();
+		workers[index].tasks.pop_front();
+	}
+	pthread_mutex_unlock(&workers[index].lock);
+	return task;
+}
+
+WsTask *WsPool::Steal(int index)
+{
+	//No tasks are added while pool is running, so if every queue is empty - work is done
+	for (size_t v=1; v<workers.size(); v++) {
+		Worker &victim=workers[(index+v)%workers.size()];
+		WsTask *task=NULL;
+		pthread_mutex_lock(&victim.lock);
+		if (!victim.tasks.empty()) {
+			task=victim.tasks.back();
+			victim.tasks.pop_back();
+		}
+		pthread_mutex_unlock(&victim.lock);
+		if (task)
+			return task;
+	}
+	return NULL;
+}
+
+void *WsPool::WorkerProc(void *arg)
+{
+	Worker *worker=(Worker*)arg;
+	WsTask *task;
+
+	while ((task=worker->pool->Pop(worker->index))||(task=worker->pool->Steal(worker->index))) {
+		task->Run(worker->index);
+		delete task;
+	}
+
+	return NULL;
+}
+
+int WsPool::GetCpuCount()
+{
+	long cpus=sysconf(_SC_NPROCESSORS_ONLN);
+	return cpus>0?cpus:1;
+}
\ No newline at end of file
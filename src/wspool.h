@@ -0,0 +1,58 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WSPOOL_H
+#define WSPOOL_H
+
+#include <deque>
+#include <vector>
+#include <pthread.h>
+
+class WsTask {
+public:
+	virtual ~WsTask() {}
+	//Worker is the index of the thread running the task - use it to pick per-thread scratch buffers
+	virtual void Run(int worker)=0;
+};
+
+//Work-stealing thread pool for command line tools
+//All tasks are submitted before Run: each worker drains it's own queue from the front, so tasks finish roughly in submission order,
+//and, when it runs dry, steals from the back of other queues (latest tasks, their owners would get to them last)
+class WsPool {
+private:
+	struct Worker {
+		WsPool *pool;
+		int index;
+		pthread_t thread;
+		pthread_mutex_t lock;
+		std::deque<WsTask*> tasks;
+	};
+
+	std::vector<Worker> workers;
+	int next_worker;
+
+	WsTask *Pop(int index);
+	WsTask *Steal(int index);
+	static void *WorkerProc(void *arg);
+public:
+	WsPool(int threads);
+	~WsPool();
+	int GetThreadCount() const;
+	//Pool takes ownership of the task
+	void Submit(WsTask *task);
+	//Blocks until all submitted tasks are finished
+	void Run();
+	static int GetCpuCount();
+};
+
+#endif //WSPOOL_H
\ No newline at end of file
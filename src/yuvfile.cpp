@@ -0,0 +1,253 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "yuvfile.h"
+
+#define Y4M_SIGNATURE "YUV4MPEG2"
+#define Y4M_FRAME_SIGNATURE "FRAME"
+#define Y4M_MAX_HEADER 1024
+
+YuvFile::YuvFile():
+	data(NULL), data_len(0), format(), frame_size(0), frame_count(0), frame_index()
+{}
+
+YuvFile::~YuvFile()
+{
+	Close();
+}
+
+bool YuvFile::Open(const char *path, const Format &raw_format, std::string &error)
+{
+	struct stat st;
+	int fd;
+
+	Close();
+
+	if ((fd=open(path, O_RDONLY))<0) {
+		error="can't open file";
+		return false;
+	}
+	if (fstat(fd, &st)||!st.st_size||(data=(unsigned char*)mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0))==MAP_FAILED) {
+		data=NULL;
+		close(fd);
+		error="can't map file";
+		return false;
+	}
+	//Mapping stays valid after descriptor is closed
+	close(fd);
+	data_len=st.st_size;
+	madvise(data, data_len, MADV_SEQUENTIAL);
+
+	size_t header_len=0;
+	if (data_len>=sizeof(Y4M_SIGNATURE)-1&&!memcmp(data, Y4M_SIGNATURE, sizeof(Y4M_SIGNATURE)-1)) {
+		//YUV4MPEG2 stream header and frame headers are terminated by newline
+		unsigned char *eol=(unsigned char*)memchr(data, '\n', std::min(data_len, (size_t)Y4M_MAX_HEADER));
+		if (!eol) {
+			error="malformed YUV4MPEG2 header";
+			Close();
+			return false;
+		}
+		if (!ParseY4mHeader(std::string((char*)data, eol-data), error)) {
+			Close();
+			return false;
+		}
+		header_len=eol+1-data;
+	} else {
+		format=raw_format;
+	}
+
+	if (format.width<=0||format.height<=0||format.fps_numerator<=0||format.fps_denominator<=0) {
+		error="invalid video format";
+		Close();
+		return false;
+	}
+
+	frame_size=GetFrameSize(format);
+
+	if (header_len) {
+		if (!BuildY4mIndex(header_len)) {
+			error="malformed YUV4MPEG2 frame header";
+			Close();
+			return false;
+		}
+		frame_count=frame_index.size();
+	} else {
+		frame_count=data_len/frame_size;
+	}
+
+	return true;
+}
+
+//Frames have fixed size so index is built by hopping from one frame header to another
+//Only headers are touched - frame data isn't read until it's actually requested
+bool YuvFile::BuildY4mIndex(size_t offset)
+{
+	frame_index.clear();
+	while (offset<data_len) {
+		unsigned char *eol=(unsigned char*)memchr(data+offset, '\n', std::min(data_len-offset, (size_t)Y4M_MAX_HEADER));
+		if (!eol||data_len-offset<sizeof(Y4M_FRAME_SIGNATURE)-1||memcmp(data+offset, Y4M_FRAME_SIGNATURE, sizeof(Y4M_FRAME_SIGNATURE)-1))
+			return false;
+		offset=eol+1-data;
+		if (data_len-offset<frame_size)
+			break;	//Truncated last frame
+		frame_index.push_back(offset);
+		offset+=frame_size;
+	}
+	return true;
+}
+
+bool YuvFile::ParseY4mHeader(const std::string &header, std::string &error)
+{
+	std::istringstream iss(header);
+	std::string token;
+	char sep;
+
+	format.width=format.height=0;
+	format.fps_numerator=25;
+	format.fps_denominator=1;
+	format.width_sub=format.height_sub=1;
+	format.bit_depth=8;
+
+	iss>>token;	//Signature
+	while (iss>>token) {
+		std::istringstream value(token.substr(1));
+		switch (token[0]) {
+			case 'W':
+				value>>format.width;
+				break;
+			case 'H':
+				value>>format.height;
+				break;
+			case 'F':
+				value>>format.fps_numerator>>sep>>format.fps_denominator;
+				break;
+			case 'C':
+				if (!ParseChroma(token.substr(1), format.width_sub, format.height_sub, format.bit_depth)) {
+					error="unsupported YUV4MPEG2 colorspace \""+token.substr(1)+"\"";
+					return false;
+				}
+				break;
+			default:
+				//Interlacing, aspect ratio and extensions are ignored
+				break;
+		}
+	}
+
+	return true;
+}
+
+bool YuvFile::ParseChroma(const std::string &chroma_depth, int &width_sub, int &height_sub, int &bit_depth)
+{
+	std::string chroma=chroma_depth;
+	bit_depth=8;
+
+	size_t suffix=chroma_depth.find('p');
+	if (suffix!=std::string::npos&&suffix+1<chroma_depth.length()&&chroma_depth.find_first_not_of("0123456789", suffix+1)==std::string::npos) {
+		bit_depth=atoi(chroma_depth.c_str()+suffix+1);
+		chroma=chroma_depth.substr(0, suffix);
+		//Samples are processed as 16-bit words, 8-bit samples don't need suffix
+		if (bit_depth<=8||bit_depth>16)
+			return false;
+	}
+
+	if (!chroma.compare("420")||!chroma.compare("420jpeg")||!chroma.compare("420paldv")||!chroma.compare("420mpeg2")) {
+		width_sub=1;
+		height_sub=1;
+	} else if (!chroma.compare("422")) {
+		width_sub=1;
+		height_sub=0;
+	} else if (!chroma.compare("444")) {
+		width_sub=0;
+		height_sub=0;
+	} else if (!chroma.compare("411")) {
+		width_sub=2;
+		height_sub=0;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+void YuvFile::Close()
+{
+	if (data)
+		munmap(data, data_len);
+	data=NULL;
+	data_len=0;
+	frame_count=0;
+	frame_index.clear();
+}
+
+const YuvFile::Format &YuvFile::GetFormat() const
+{
+	return format;
+}
+
+int YuvFile::GetFrameCount() const
+{
+	return frame_count;
+}
+
+size_t YuvFile::GetFrameOffset(int n) const
+{
+	return frame_index.empty()?n*frame_size:frame_index[n];
+}
+
+bool YuvFile::GetFrame(int n, YuvImg::PlaneData *planes) const
+{
+	if (n<0||n>=frame_count)
+		return false;
+
+	GetPlanes(format, data+GetFrameOffset(n), planes);
+	return true;
+}
+
+size_t YuvFile::GetFrameSize(const Format &format)
+{
+	return ((size_t)format.width*format.height+
+		2*(size_t)((format.width+(1<<format.width_sub)-1)>>format.width_sub)*((format.height+(1<<format.height_sub)-1)>>format.height_sub))*(format.bit_depth>8?2:1);
+}
+
+void YuvFile::GetPlanes(const Format &format, unsigned char *frame, YuvImg::PlaneData *planes)
+{
+	for (int p=0; p<3; p++) {
+		planes[p].width_sub=p?format.width_sub:0;
+		planes[p].height_sub=p?format.height_sub:0;
+		planes[p].width=(format.width+(1<<planes[p].width_sub)-1)>>planes[p].width_sub;
+		planes[p].height=(format.height+(1<<planes[p].height_sub)-1)>>planes[p].height_sub;
+		planes[p].bit_depth=format.bit_depth;
+		planes[p].width*=format.bit_depth>8?2:1;
+		planes[p].pitch=planes[p].width;
+		planes[p].ptr=p?planes[p-1].ptr+planes[p-1].pitch*planes[p-1].height:frame;
+	}
+}
+
+void YuvFile::AdviseFrame(int n) const
+{
+	if (n<0||n>=frame_count)
+		return;
+
+	//madvise wants page aligned address
+	size_t page=sysconf(_SC_PAGESIZE);
+	size_t offset=GetFrameOffset(n);
+	size_t aligned=offset-offset%page;
+	madvise(data+aligned, offset-aligned+frame_size, MADV_WILLNEED);
+}
\ No newline at end of file
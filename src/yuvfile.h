@@ -0,0 +1,65 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef YUVFILE_H
+#define YUVFILE_H
+
+#include <string>
+#include <vector>
+#include "yuvimg.h"
+
+//Planar YUV video file reader (YUV4MPEG2 or headerless raw video) for command line tools
+//File is memory mapped and frames are handed out as plane pointers into the mapping - no copies are made
+class YuvFile {
+public:
+	struct Format {
+		int width;
+		int height;
+		int fps_numerator;
+		int fps_denominator;
+		int width_sub;			//Chroma subsampling, log2
+		int height_sub;
+		int bit_depth;			//Samples of more than 8 bits take 16-bit little endian words
+	};
+private:
+	unsigned char *data;
+	size_t data_len;
+	Format format;
+	size_t frame_size;			//Length of frame planes
+	int frame_count;
+	std::vector<size_t> frame_index;	//Offsets of YUV4MPEG2 frame planes, empty for raw video
+
+	bool ParseY4mHeader(const std::string &header, std::string &error);
+	bool BuildY4mIndex(size_t offset);
+	size_t GetFrameOffset(int n) const;
+public:
+	YuvFile();
+	~YuvFile();
+	//Format is used only for raw video - YUV4MPEG2 files are detected by signature and described by it's header
+	bool Open(const char *path, const Format &raw_format, std::string &error);
+	void Close();
+	const Format &GetFormat() const;
+	int GetFrameCount() const;
+	//Fills planes[3] with read-only pointers into mapped file, valid until file is closed
+	bool GetFrame(int n, YuvImg::PlaneData *planes) const;
+	//Hints the kernel to start reading frame that will be requested soon (useful when frames are skipped)
+	void AdviseFrame(int n) const;
+	//Length of frame planes
+	static size_t GetFrameSize(const Format &format);
+	//Fills planes[3] with views of planes packed one after another starting at frame
+	static void GetPlanes(const Format &format, unsigned char *frame, YuvImg::PlaneData *planes);
+	//Chroma is YUV4MPEG2 colorspace, high bit depth ones have "p<bits>" suffix (e.g. 420p10)
+	static bool ParseChroma(const std::string &chroma, int &width_sub, int &height_sub, int &bit_depth);
+};
+
+#endif //YUVFILE_H
\ No newline at end of file
@@ -12,25 +12,14 @@
 */
 
 #include <algorithm>
-#include <windows.h>
 #include "yuvimg.h"
 
-YuvImg::YuvImg(const PVideoFrame &src, const VideoInfo &vi):
-	img_height(vi.height), img_width(vi.width), yuv_data(), read_only(!src->IsWritable())
+//Image doesn't own plane buffers - they should stay valid for the lifetime of the object
+YuvImg::YuvImg(const PlaneData *planes, int width, int height, bool read_only):
+	img_height(height), img_width(width), read_only(read_only), yuv_data()
 {
-	const int yuv_planes[3]={PLANAR_Y, PLANAR_U, PLANAR_V};
-
-	for (int p=0; p<3; p++) {
-		if (read_only)
-			yuv_data[p].ptr=(unsigned char*)src->GetReadPtr(yuv_planes[p]);	
-		else
-			yuv_data[p].ptr=src->GetWritePtr(yuv_planes[p]);
-		yuv_data[p].pitch=src->GetPitch(yuv_planes[p]);
-		yuv_data[p].width=src->GetRowSize(yuv_planes[p]);
-		yuv_data[p].height=src->GetHeight(yuv_planes[p]);
-		yuv_data[p].width_sub=vi.GetPlaneWidthSubsampling(yuv_planes[p]);
-		yuv_data[p].height_sub=vi.GetPlaneHeightSubsampling(yuv_planes[p]);
-	}
+	for (int p=0; p<3; p++)
+		yuv_data[p]=planes[p];
 }
 
 int YuvImg::GetHeight() const
@@ -43,11 +32,35 @@ int YuvImg::GetWidth() const
 	return img_width;
 }
 
-unsigned char YuvImg::QueryYuvLuma(int x, int y) const
+const YuvImg::PlaneData *YuvImg::GetPlanes() const
+{
+	return yuv_data;
+}
+
+int YuvImg::GetBitDepth() const
+{
+	return yuv_data[0].bit_depth;
+}
+
+int YuvImg::GetMaxLuma() const
+{
+	return (1<<yuv_data[0].bit_depth)-1;
+}
+
+int YuvImg::QueryYuvLuma(int x, int y) const
 {
 	if (x<0||y<0||x>=img_width||y>=img_height)
 		return 0;
-	return *(yuv_data[0].ptr+yuv_data[0].pitch*y+x);
+	const unsigned char *row=yuv_data[0].ptr+yuv_data[0].pitch*y;
+	return yuv_data[0].bit_depth>8?((const unsigned short*)row)[x]:row[x];
+}
+
+void YuvImg::FillSamples(const PlaneData &plane, unsigned char *row, int x1, int x2, unsigned char value)
+{
+	if (plane.bit_depth>8)
+		std::fill((unsigned short*)row+x1, (unsigned short*)row+x2+1, (unsigned short)(value<<(plane.bit_depth-8)));
+	else
+		std::fill(row+x1, row+x2+1, value);
 }
 
 void YuvImg::SetYuvPixel(int x, int y, const unsigned char *yuv_color)
@@ -55,7 +68,7 @@ void YuvImg::SetYuvPixel(int x, int y, const unsigned char *yuv_color)
 	if (read_only||x<0||y<0||x>=img_width||y>=img_height)
 		return;
 	for (int p=0; p<3; p++)
-		*(yuv_data[p].ptr+yuv_data[p].pitch*(y>>yuv_data[p].height_sub)+(x>>yuv_data[p].width_sub))=yuv_color[p];
+		FillSamples(yuv_data[p], yuv_data[p].ptr+yuv_data[p].pitch*(y>>yuv_data[p].height_sub), x>>yuv_data[p].width_sub, x>>yuv_data[p].width_sub, yuv_color[p]);
 }
 
 void YuvImg::DrawYuvHorizontalLine(int x1, int x2, int y, const unsigned char *yuv_color)
@@ -64,7 +77,7 @@ void YuvImg::DrawYuvHorizontalLine(int x1, int x2, int y, const unsigned char *y
 		return;
 	for (int p=0; p<3; p++) {
 		unsigned char* ptr=yuv_data[p].ptr+yuv_data[p].pitch*(y>>yuv_data[p].height_sub);
-		std::fill(ptr+(x1>>yuv_data[p].width_sub), ptr+(x2>>yuv_data[p].width_sub)+1, yuv_color[p]); 
+		FillSamples(yuv_data[p], ptr, x1>>yuv_data[p].width_sub, x2>>yuv_data[p].width_sub, yuv_color[p]); 
 	}
 }
 
@@ -75,7 +88,7 @@ void YuvImg::DrawYuvVerticalLine(int x, int y1, int y2, const unsigned char *yuv
 	for (int p=0; p<3; p++) {
 		unsigned char* ptr=yuv_data[p].ptr+yuv_data[p].pitch*(y1>>yuv_data[p].height_sub);
 		while (ptr<=yuv_data[p].ptr+yuv_data[p].pitch*(y2>>yuv_data[p].height_sub)) {
-			*(ptr+(x>>yuv_data[p].width_sub))=yuv_color[p];
+			FillSamples(yuv_data[p], ptr, x>>yuv_data[p].width_sub, x>>yuv_data[p].width_sub, yuv_color[p]);
 			ptr+=yuv_data[p].pitch;
 		}
 	}
@@ -87,13 +100,13 @@ void YuvImg::DrawYuvRectangle(int x1, int y1, int x2, int y2, const unsigned cha
 		return;
 	for (int p=0; p<3; p++) {
 		unsigned char* ptr=yuv_data[p].ptr+yuv_data[p].pitch*(y1>>yuv_data[p].height_sub);
-		std::fill(ptr+(x1>>yuv_data[p].width_sub), ptr+(x2>>yuv_data[p].width_sub)+1, yuv_color[p]);
+		FillSamples(yuv_data[p], ptr, x1>>yuv_data[p].width_sub, x2>>yuv_data[p].width_sub, yuv_color[p]);
 		while (ptr<yuv_data[p].ptr+yuv_data[p].pitch*(y2>>yuv_data[p].height_sub)) {
-			*(ptr+(x1>>yuv_data[p].width_sub))=yuv_color[p];
-			*(ptr+(x2>>yuv_data[p].width_sub))=yuv_color[p];
+			FillSamples(yuv_data[p], ptr, x1>>yuv_data[p].width_sub, x1>>yuv_data[p].width_sub, yuv_color[p]);
+			FillSamples(yuv_data[p], ptr, x2>>yuv_data[p].width_sub, x2>>yuv_data[p].width_sub, yuv_color[p]);
 			ptr+=yuv_data[p].pitch;
 		}
-		std::fill(ptr+(x1>>yuv_data[p].width_sub), ptr+(x2>>yuv_data[p].width_sub)+1, yuv_color[p]);
+		FillSamples(yuv_data[p], ptr, x1>>yuv_data[p].width_sub, x2>>yuv_data[p].width_sub, yuv_color[p]);
 	}
 }
 
@@ -101,6 +114,40 @@ void YuvImg::MakeMonochrome()
 {
 	if (read_only)
 		return;
+	//Rows are filled separately so cropped image doesn't touch pixels outside of it
 	for (int p=1; p<3; p++)
-		std::fill(yuv_data[p].ptr, yuv_data[p].ptr+yuv_data[p].pitch*yuv_data[p].height, (unsigned char)128); 
+		for (int y=0; y<yuv_data[p].height; y++)
+			FillSamples(yuv_data[p], yuv_data[p].ptr+yuv_data[p].pitch*y, 0, (yuv_data[p].bit_depth>8?yuv_data[p].width/2:yuv_data[p].width)-1, 128); 
+}
+
+void YuvImg::Crop(int x, int y, int w, int h)
+{
+	int x_align=1<<std::max(yuv_data[1].width_sub, yuv_data[2].width_sub);
+	int y_align=1<<std::max(yuv_data[1].height_sub, yuv_data[2].height_sub);
+	int x2=std::min(x+w, img_width);
+	int y2=std::min(y+h, img_height);
+
+	x=std::max(x, 0)/x_align*x_align;
+	y=std::max(y, 0)/y_align*y_align;
+	if (x2<x) x2=x;
+	if (y2<y) y2=y;
+
+	for (int p=0; p<3; p++) {
+		int bytes=yuv_data[p].bit_depth>8?2:1;
+		yuv_data[p].ptr+=yuv_data[p].pitch*(y>>yuv_data[p].height_sub)+(x>>yuv_data[p].width_sub)*bytes;
+		yuv_data[p].width=((x2-x+(1<<yuv_data[p].width_sub)-1)>>yuv_data[p].width_sub)*bytes;
+		yuv_data[p].height=(y2-y+(1<<yuv_data[p].height_sub)-1)>>yuv_data[p].height_sub;
+	}
+	img_width=x2-x;
+	img_height=y2-y;
+}
+
+void YuvImg::SelectField(int field)
+{
+	for (int p=0; p<3; p++) {
+		yuv_data[p].ptr+=yuv_data[p].pitch*field;
+		yuv_data[p].pitch*=2;
+		yuv_data[p].height=(yuv_data[p].height-field+1)/2;
+	}
+	img_height=(img_height-field+1)/2;
 }
\ No newline at end of file
@@ -14,10 +14,11 @@
 #ifndef YUVIMG_H
 #define YUVIMG_H
 
-#include "avisynth.h"
-
 class YuvImg {
-protected: 
+public:
+	//Describes single plane of caller-owned frame buffer
+	//Width is in bytes (same as AviSynth row size), subsampling is log2 of plane to luma ratio
+	//Samples of more than 8 bits are stored in native endian 16-bit words (e.g. YUV4MPEG2 p10 or p16 on x86)
 	struct PlaneData {
 		unsigned char* ptr;
 		int pitch;
@@ -25,22 +26,36 @@ protected:
         int height;
         int width_sub;
         int height_sub;
+		int bit_depth;
 	};
-
+protected: 
 	int img_height;
 	int img_width;
 	bool read_only;
 	PlaneData yuv_data[3];
+
+	//Fills samples x1..x2 of plane row with 8-bit value scaled to plane bit depth
+	static void FillSamples(const PlaneData &plane, unsigned char *row, int x1, int x2, unsigned char value);
 public:
-	YuvImg(const PVideoFrame &src, const VideoInfo &vi);
+	YuvImg(const PlaneData *planes, int width, int height, bool read_only);
 	int GetHeight() const;
 	int GetWidth() const;
-	unsigned char QueryYuvLuma(int x, int y) const;
+	const PlaneData *GetPlanes() const;
+	int GetBitDepth() const;
+	//Maximum luminance value at image bit depth
+	int GetMaxLuma() const;
+	//Luminance at image bit depth
+	int QueryYuvLuma(int x, int y) const;
+	//Colors are 8-bit and are scaled to image bit depth
 	void SetYuvPixel(int x, int y, const unsigned char *yuv_color);
 	void DrawYuvHorizontalLine(int x1, int x2, int y, const unsigned char *yuv_color);
 	void DrawYuvVerticalLine(int x, int y1, int y2, const unsigned char *yuv_color);
 	void DrawYuvRectangle(int x1, int y1, int x2, int y2, const unsigned char *yuv_color);
 	void MakeMonochrome();
+	//Makes image a view of the rectangle (x,y),(x+w,y+h), top-left corner is aligned down to chroma subsampling
+	void Crop(int x, int y, int w, int h);
+	//Makes image a view of even (field 0) or odd (field 1) lines of interlaced frame by doubling pitch of every plane
+	void SelectField(int field);
 };
 
 #endif //YUVIMG_H
\ No newline at end of file
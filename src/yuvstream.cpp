@@ -0,0 +1,224 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "yuvstream.h"
+
+void YuvStream::Queue::Init(int capacity)
+{
+	items.assign(capacity, -1);
+	head=0;
+	tail=0;
+}
+
+bool YuvStream::Queue::IsFull() const
+{
+	return head-tail>=(long)items.size();
+}
+
+//Item is stored before head is published, so popping thread never sees the slot before it's written
+bool YuvStream::Queue::Push(int item)
+{
+	if (IsFull())
+		return false;
+	items[head%items.size()]=item;
+	__sync_synchronize();
+	head++;
+	return true;
+}
+
+//Slot can't be reused by Push until tail is moved past it, so item read before successful swap is valid
+bool YuvStream::Queue::Pop(int &item)
+{
+	for (;;) {
+		long cur_tail=tail;
+		__sync_synchronize();
+		if (cur_tail==head)
+			return false;
+		item=items[cur_tail%items.size()];
+		if (__sync_bool_compare_and_swap(&tail, cur_tail, cur_tail+1))
+			return true;
+	}
+}
+
+YuvStream::YuvStream(const YuvFile::Format &format, int interval, int first_frame, int last_frame, int depth, bool drop):
+	fd(-1), wake(), format(format), frame_size(YuvFile::GetFrameSize(format)), timer(format.fps_numerator, format.fps_denominator, interval),
+	first_frame(first_frame), last_frame(last_frame), drop(drop), buffers(), frames(), queued(), released(), current(-1), eos(false), stop(false), started(false), reader(), stats()
+{
+	wake[0]=wake[1]=-1;
+	//Reader and recognizer hold one buffer each besides the queued ones, so reader always finds released buffer after queuing a frame
+	if (depth<=0)
+		depth=STREAM_DEPTH;
+	buffers.resize(frame_size*(depth+2));
+	frames.resize(depth+2);
+	queued.Init(depth);
+	released.Init(depth+2);
+	for (int b=0; b<depth+2; b++)
+		released.Push(b);
+}
+
+YuvStream::~YuvStream()
+{
+	//Closing fd doesn't wake read that is blocked on a pipe, so reader waits for it together with wake pipe
+	if (started) {
+		stop=true;
+		__sync_synchronize();
+		char byte=0;
+		while (write(wake[1], &byte, 1)<0&&errno==EINTR);
+		pthread_join(reader, NULL);
+	}
+	for (int i=0; i<2; i++)
+		if (wake[i]>=0)
+			close(wake[i]);
+	if (fd>STDIN_FILENO)
+		close(fd);
+}
+
+bool YuvStream::Open(const char *path, std::string &error)
+{
+	if (format.width<=0||format.height<=0||format.fps_numerator<=0||format.fps_denominator<=0) {
+		error="invalid video format (frame size of raw video is required)";
+		return false;
+	}
+	if (!strcmp(path, "-"))
+		fd=STDIN_FILENO;
+	else if ((fd=open(path, O_RDONLY))<0) {
+		error="can't open file";
+		return false;
+	}
+	if (pipe(wake)) {
+		wake[0]=wake[1]=-1;
+		error="can't create pipe";
+		return false;
+	}
+	if (pthread_create(&reader, NULL, ReaderProc, this)) {
+		error="can't start reader thread";
+		return false;
+	}
+	started=true;
+	return true;
+}
+
+const YuvFile::Format &YuvStream::GetFormat() const
+{
+	return format;
+}
+
+const SsocrTimer &YuvStream::GetTimer() const
+{
+	return timer;
+}
+
+const YuvStream::Stats &YuvStream::GetStats() const
+{
+	return stats;
+}
+
+bool YuvStream::IsStream(const char *path)
+{
+	struct stat st;
+	return !strcmp(path, "-")||(!stat(path, &st)&&(S_ISFIFO(st.st_mode)||S_ISCHR(st.st_mode)));
+}
+
+void YuvStream::Pause()
+{
+	struct timespec ts={0, STREAM_POLL_USEC*1000};
+	nanosleep(&ts, NULL);
+}
+
+//Pipe returns frame in pieces of any size, partial frame at the end of stream is dropped
+//Data is waited for with poll, so destructor can stop reader that waits for a stalled writer
+bool YuvStream::ReadFrame(unsigned char *frame)
+{
+	for (size_t done=0; done<frame_size;) {
+		struct pollfd fds[2]={{fd, POLLIN, 0}, {wake[0], POLLIN, 0}};
+		if (poll(fds, 2, -1)<0) {
+			if (errno==EINTR)
+				continue;
+			return false;
+		}
+		if (stop||fds[1].revents)
+			return false;
+		ssize_t len=read(fd, frame+done, frame_size-done);
+		if (len<0&&errno==EINTR)
+			continue;
+		if (len<=0)
+			return false;
+		done+=len;
+	}
+	return true;
+}
+
+void *YuvStream::ReaderProc(void *arg)
+{
+	YuvStream *stream=(YuvStream*)arg;
+	int buffer;
+
+	stream->released.Pop(buffer);
+	for (int n=0; stream->last_frame<0||n<=stream->last_frame; n++) {
+		if (!stream->ReadFrame(&stream->buffers[stream->frame_size*buffer]))
+			break;
+		stream->stats.frames_read++;
+		//Frames that aren't sampled are read into the same buffer again
+		if (n<stream->first_frame||!stream->timer.CheckTimer(stream->timer.GetMseconds(n)))
+			continue;
+		stream->frames[buffer]=n;
+		int oldest;
+		if (stream->drop&&stream->queued.IsFull()&&stream->queued.Pop(oldest)) {
+			stream->stats.frames_dropped++;
+			stream->queued.Push(buffer);
+			buffer=oldest;
+		} else {
+			while (!stream->stop&&!stream->queued.Push(buffer))
+				Pause();
+			while (!stream->stop&&!stream->released.Pop(buffer))
+				Pause();
+			if (stream->stop)
+				break;
+		}
+		stream->stats.frames_queued++;
+	}
+
+	__sync_synchronize();
+	stream->eos=true;
+	return NULL;
+}
+
+bool YuvStream::GetFrame(int &n, YuvImg::PlaneData *planes)
+{
+	if (current>=0) {
+		released.Push(current);
+		current=-1;
+	}
+	for (;;) {
+		//End of stream is checked before the queue, so frames queued before it was set are still taken
+		bool ended=eos;
+		__sync_synchronize();
+		if (queued.Pop(current))
+			break;
+		if (ended) {
+			current=-1;
+			return false;
+		}
+		Pause();
+	}
+	n=frames[current];
+	YuvFile::GetPlanes(format, &buffers[frame_size*current], planes);
+	return true;
+}
\ No newline at end of file
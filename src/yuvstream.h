@@ -0,0 +1,92 @@
+/*
+* SegmentDisplayOCR AviSynth Filter
+* Copyright (C) 2014 Lcferrum <lcferrum@yandex.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef YUVSTREAM_H
+#define YUVSTREAM_H
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "yuvfile.h"
+#include "ssocr_timer.h"
+
+/* queue of a stream holds 8 frames unless told otherwise */
+#define STREAM_DEPTH 8
+
+/* idle side of the queue sleeps this much before checking it again */
+#define STREAM_POLL_USEC 1000
+
+//Raw planar YUV video read from pipe (stdin or FIFO) for command line tools
+//Reader thread reads every frame into preallocated ring of frame buffers and queues sampled ones for recognizer thread
+//Buffers are handed over by index through lock-free single-producer single-consumer queues, so nothing is allocated per frame
+//When queue is full reader either waits, so writer of the pipe is blocked (backpressure), or drops the oldest queued frame (live sources)
+class YuvStream {
+public:
+	struct Stats {
+		int frames_read;
+		int frames_queued;
+		int frames_dropped;
+	};
+private:
+	//Buffer indices, single thread pushes, pops are claimed by compare-and-swap
+	//so reader can also pop from the queue it fills when it drops the oldest frame
+	class Queue {
+	private:
+		std::vector<int> items;
+		volatile long head;		//Next item to push, written by pushing thread only
+		volatile long tail;		//Next item to pop
+	public:
+		void Init(int capacity);
+		bool IsFull() const;
+		bool Push(int item);
+		bool Pop(int &item);
+	};
+
+	int fd;
+	int wake[2];				//Pipe that is written to stop reader blocked in read, -1 if not created
+	YuvFile::Format format;
+	size_t frame_size;
+	SsocrTimer timer;
+	int first_frame;
+	int last_frame;				//Inclusive, -1 means end of stream
+	bool drop;
+	std::vector<unsigned char> buffers;
+	std::vector<int> frames;	//Frame number of every buffer
+	Queue queued;				//Reader -> recognizer
+	Queue released;				//Recognizer -> reader
+	int current;				//Buffer held by recognizer, -1 if none
+	volatile bool eos;
+	volatile bool stop;			//Set by destructor, reader leaves as soon as it sees it
+	bool started;
+	pthread_t reader;
+	Stats stats;
+
+	bool ReadFrame(unsigned char *frame);
+	static void *ReaderProc(void *arg);
+	static void Pause();
+public:
+	YuvStream(const YuvFile::Format &format, int interval, int first_frame, int last_frame, int depth, bool drop);
+	~YuvStream();
+	//Path "-" is stdin, reader thread is started on success
+	bool Open(const char *path, std::string &error);
+	const YuvFile::Format &GetFormat() const;
+	const SsocrTimer &GetTimer() const;
+	//Blocks until next queued frame, planes stay valid until next call, returns false at end of stream
+	bool GetFrame(int &n, YuvImg::PlaneData *planes);
+	//Valid after GetFrame returned false
+	const Stats &GetStats() const;
+	//Input is pipe or character device that can't be mapped
+	static bool IsStream(const char *path);
+};
+
+#endif //YUVSTREAM_H
\ No newline at end of file